@@ -1,7 +1,9 @@
 #ifndef _PIXIRETRO_IO_BMPIMAGE_H_
 #define _PIXIRETRO_IO_BMPIMAGE_H_
 
-#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdint>
 #include "pxr_color.h"
 #include "pxr_vec.h"
 
@@ -13,11 +15,22 @@ namespace io
 //
 // Represents a bitmap (.bmp) image file.
 //
+// The pixels are stored in a single contiguous buffer, aligned to PIXEL_ALIGNMENT bytes, with
+// rows ordered bottom (row 0) to top. Each row is padded to a stride which is a multiple of 
+// PIXEL_ALIGNMENT bytes so every row starts aligned. Access pixel [row][col] as:
+//
+//    getPixels()[col + (row * getStride())]   or   getRow(row)[col]
+//
 class Bmp
 {
 public:
   static constexpr const char* FILE_EXTENSION {".bmp"};
 
+  //
+  // Alignment of the pixel buffer and of each row within it; one cache line.
+  //
+  static constexpr int PIXEL_ALIGNMENT {64};
+
 public:
   Bmp();
   ~Bmp();
@@ -28,16 +41,32 @@ public:
   Bmp& operator=(Bmp&& other);
 
   bool load(std::string filepath);
+
+  //
+  // Writes the image as an uncompressed 32 bit bmp (with a v4 header so the alpha channel is 
+  // kept) which load reads back exactly. Returns false if the file cannot be written.
+  //
+  bool save(const std::string& filepath) const;
   void create(Vector2i size, gfx::Color4u fill);
 
+  //
+  // Makes the image a non-owning view of pixels held elsewhere, e.g. in a memory mapped asset
+  // archive. The pixels must be in the layout described above (stride and alignment) and must
+  // outlive the image. Copies of a view own a copy of the pixels.
+  //
+  void view(gfx::Color4u* pixels, Vector2i size, int stride);
+  bool isView() const {return _isView;}
+
   void clear(gfx::Color4u color);
 
-  const gfx::Color4u getPixel(int row, int col);
-  const gfx::Color4u* getRow(int row);
-  const gfx::Color4u* const* getPixels() const {return _pixels;}
+  gfx::Color4u getPixel(int row, int col) const;
+  const gfx::Color4u* getRow(int row) const;
+  gfx::Color4u* getRow(int row);
+  const gfx::Color4u* getPixels() const {return _pixels;}
 
   int getWidth() const {return _size._x;}
   int getHeight() const {return _size._y;}
+  int getStride() const {return _stride;}
   Vector2i getSize() const {return _size;}
 
 private:
@@ -105,20 +134,32 @@ private:
 private:
   void freePixels();
   void reallocatePixels();
-  void extractIndexedPixels(std::ifstream& file, FileHeader& fileHead, InfoHeader& infoHead);
-  void extractPixels(std::ifstream& file, FileHeader& fileHead, InfoHeader& infoHead);
+  static int calculateStride(int width);
+  void copyPixels(const Bmp& other);
+  void extractIndexedPixels(const std::vector<uint8_t>& file, FileHeader& fileHead, InfoHeader& infoHead);
+  void extractPixels(const std::vector<uint8_t>& file, FileHeader& fileHead, InfoHeader& infoHead);
+  static std::size_t calculateRowSize(int bitsPerPixel, int width);
 
 private:
   //
-  // Raw pixel data accessed by [row][col], i.e. _pixels is a pointer to an array of pixel
-  // rows.
+  // Raw pixel data accessed by [col + (row * _stride)].
   //
-  gfx::Color4u** _pixels;
+  gfx::Color4u* _pixels;
 
   //
   // Size/dimensions of the bmp image: x=width (num cols) and y=height (num rows).
   //
   Vector2i _size;
+
+  //
+  // Number of pixels between the start of consecutive rows; _stride >= _size._x.
+  //
+  int _stride;
+
+  //
+  // True if the pixels are not owned by the image; see view.
+  //
+  bool _isView;
 };
 
 } // namespace io
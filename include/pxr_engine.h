@@ -5,6 +5,8 @@
 
 #include <memory>
 #include <chrono>
+#include <array>
+#include <string>
 
 #include "pxr_rc.h"
 #include "pxr_game.h"
@@ -54,12 +56,11 @@ private:
   static constexpr Duration_t oneSecond      {1'000'000'000 };
   static constexpr Duration_t oneHalfSecond  {500'000'000   };
   static constexpr Duration_t oneMinute      {60'000'000'000};
-  static constexpr Duration_t minFramePeriod {1'000'000     };
 
   static constexpr float splashDurationSeconds     {1.0f};
   static constexpr float splashWaitDurationSeconds {1.0f};
 
-  static constexpr Vector2i statsScreenResolution {500, 200};
+  static constexpr Vector2i statsScreenResolution {500, 300};
   static constexpr Vector2i pauseScreenResolution {100, 60};
 
   //
@@ -77,6 +78,7 @@ private:
   static constexpr int pauseGameClockKey          {SDLK_p           };
   static constexpr int toggleDrawEngineStatsKey   {SDLK_BACKQUOTE   };
   static constexpr int skipSplashKey              {SDLK_ESCAPE      };
+  static constexpr int exportProfileKey           {SDLK_F12         };
 
   //
   // The name of the splash screen assets used by the engine. The engine will attempt 
@@ -91,19 +93,61 @@ private:
   //
   static constexpr const char* splashName {"pixiretro_splash"};
 
+  //
+  // Setting this environment variable to anything but 0 runs the engine headless regardless of
+  // the headless rc property, and setting it to 0 runs with a window regardless; see EngineRC.
+  //
+  static constexpr const char* headlessEnvVar {"PXR_HEADLESS"};
+
+  //
+  // The directory, w.r.t the app root, headless runs dump the enabled screens to. Dumps are
+  // named <headlessDumpPath>/frame<frame number>_screen<screen id>.bmp.
+  //
+  static constexpr const char* headlessDumpPath {"frames"};
+
+  //
+  // The file, w.r.t the app root, the profiler trace is exported to when the export profile key
+  // is pressed, and at the end of headless runs which have a frame limit.
+  //
+  static constexpr const char* profileTracePath {"profile.json"};
+
+  //
+  // The max number of scopes of the profiler breakdown shown on the engine stats screen.
+  //
+  static constexpr int maxStatsProfileScopes {13};
+
+  //
+  // The stats screen frame time percentiles cover between one and two windows of this length;
+  // see FrameTimes.
+  //
+  static constexpr Duration_t statsWindowPeriod {5'000'000'000};
+
+  //
+  // The number of frames shown by the frame time graph of the engine stats screen; one per 
+  // pixel column.
+  //
+  static constexpr int frameTimeGraphSize {480};
+
   //
   // A clock to record the real passage of time.
   //
+  // The clock can instead be simulated, advancing by a fixed step with every update regardless
+  // of the real passage of time; used to make headless runs deterministic. A zero step restores
+  // real time.
+  //
   class RealClock
   {
   public:
-    RealClock() : _start{}, _now{}{}
+    RealClock() : _start{}, _now{}, _simulatedStep{0}{}
     void reset(){_now = _start = Clock_t::now();}
     Duration_t update();
     Duration_t getNow() {return _now - _start;}
+    TimePoint_t toTimePoint(Duration_t now) const {return _start + now;}
+    void setSimulatedStep(Duration_t step){_simulatedStep = step;}
   private:
     TimePoint_t _start;
     TimePoint_t _now;
+    Duration_t _simulatedStep;
   };
 
   //
@@ -168,9 +212,12 @@ private:
     int getTicksDoneTotal() const {return _ticksDoneTotal;}
     int getTicksDoneThisFrame() const {return _ticksDoneThisFrame;}
     int getTicksAccumulated() const {return _ticksAccumulated;}
+    Duration_t getNextTickNow() const {return _tickerNow + _tickPeriod;}
+    float getTickAlpha(Duration_t now) const;
     const std::array<double, FPS_HISTORY_SIZE>& getTickFrequencyHistory() {return _measuredTickFrequencyHistory;}
     bool isNewTickFrequencySample() const {return _isNewTickFrequencySample;}
     void setCallback(Callback_t onTick){_onTick = onTick;}
+    void setTickPeriod(Duration_t tickPeriod);
     
   private:
     Callback_t _onTick;
@@ -199,6 +246,121 @@ private:
     bool _isNewTickFrequencySample;
   };
 
+  //
+  // A histogram of durations from which percentiles can be read in constant memory, in the style
+  // of an HDR histogram. 
+  //
+  // Durations are recorded with a resolution of one microsecond and bucketed log-linearly: each 
+  // power of two range of durations is split into SUB_BUCKET_COUNT equal width buckets, thus 
+  // reported percentiles are within 1/SUB_BUCKET_COUNT (~3%) of the recorded durations, whether 
+  // microseconds or seconds. Durations longer than MAX_DURATION_US are recorded as such. The max
+  // duration is tracked exactly.
+  //
+  class DurationHistogram
+  {
+  public:
+    static constexpr int SUB_BUCKET_BITS {5};
+    static constexpr int SUB_BUCKET_COUNT {1 << SUB_BUCKET_BITS};
+    static constexpr int MAX_DURATION_BITS {32};
+    static constexpr int64_t MAX_DURATION_US {(int64_t{1} << MAX_DURATION_BITS) - 1};
+    static constexpr int BUCKET_COUNT {(MAX_DURATION_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT};
+
+  public:
+    DurationHistogram(){reset();}
+    void record(Duration_t duration);
+    void add(const DurationHistogram& other);
+    void reset();
+
+    //
+    // Returns the smallest duration which percentile % of recorded durations do not exceed; to
+    // within the bucket precision. Returns zero if the histogram is empty.
+    //
+    Duration_t getPercentile(double percentile) const;
+
+    Duration_t getMax() const {return _max;}
+    int64_t getCount() const {return _count;}
+
+    //
+    // Returns the p50, p95, p99 and max durations in milliseconds, and the count.
+    //
+    std::string toString() const;
+
+  private:
+    static int durationToBucket(int64_t us);
+    static int64_t bucketToDuration(int bucket);
+
+  private:
+    std::array<uint32_t, BUCKET_COUNT> _buckets;
+    int64_t _count;
+    Duration_t _max;
+  };
+
+  //
+  // Histograms of the frame, update tick and draw tick durations. Frame durations are the real 
+  // time between draw ticks, i.e. what players see, whilst the update and draw durations are the
+  // time taken by each tick.
+  //
+  struct FrameTimes
+  {
+    void add(const FrameTimes& other);
+    void reset();
+    std::string toString() const;
+
+    DurationHistogram _frame;
+    DurationHistogram _update;
+    DurationHistogram _draw;
+  };
+
+  //
+  // Waits until a deadline without overshooting it; used to idle the mainloop until the next 
+  // tick is due.
+  //
+  // Sleeping alone is imprecise as threads wake up to a scheduler quantum late, whilst spinning
+  // alone wastes a core. The pacer thus sleeps in short requests until the deadline is within
+  // the time a sleep is expected to take, then spins, yielding the thread, for the rest. The 
+  // expected sleep time is the mean plus one standard deviation of the measured sleep times, 
+  // thus calibrates to the oversleep of the platform and its current load. 
+  //
+  class FramePacer
+  {
+  public:
+    static constexpr Duration_t SLEEP_QUANTUM {1'000'000};
+
+    //
+    // Sleeps measured longer are counted as this long, so one-off stalls, e.g. the machine 
+    // suspending, do not have the pacer spin for the following seconds.
+    //
+    static constexpr Duration_t MAX_SLEEP_SAMPLE {20'000'000};
+
+    //
+    // The weight of each new sleep sample in the moving average.
+    //
+    static constexpr double SLEEP_SAMPLE_WEIGHT {1.0 / 16.0};
+
+  public:
+    FramePacer(){reset();}
+    void waitUntil(TimePoint_t deadline);
+    void reset();
+    Duration_t getExpectedSleep() const;
+
+  private:
+    double _sleepMean;         // unit: ns.
+    double _sleepVariance;     // unit: ns^2.
+  };
+
+  //
+  // Headless runs (see gfx::initializeHeadless) have no window and a simulated real clock which
+  // advances one tick period every frame, thus draw a frame every tick as fast as possible and,
+  // with the random generator seeded with a fixed seed, are deterministic. Headless runs quit 
+  // after drawing headlessFrames frames (0 for no limit) and dump the enabled screens every 
+  // headlessDumpPeriod frames (0 for never). Sound is played to a dummy audio device.
+  //
+  // The frame time percentiles are logged every statsLogPeriod seconds (0 for never); useful to
+  // catch hitches in long running soak tests.
+  //
+  // With vsync presents wait for the display refresh, if the driver supports it, which avoids
+  // tearing; best used with an fpsLock matching the display refresh rate. Ignored when headless.
+  //
   class EngineRC final : public io::RC
   {
   public:
@@ -212,25 +374,49 @@ private:
       KEY_CLEAR_RED,
       KEY_CLEAR_GREEN,
       KEY_CLEAR_BLUE,
-      KEY_FPS_LOCK
+      KEY_FPS_LOCK,
+      KEY_WORKER_THREADS,
+      KEY_DRAW_COMMAND_BUFFER,
+      KEY_HOT_RELOAD,
+      KEY_HEADLESS,
+      KEY_HEADLESS_FRAMES,
+      KEY_HEADLESS_DUMP_PERIOD,
+      KEY_STATS_LOG_PERIOD,
+      KEY_VSYNC
     };
 
     EngineRC() : RC({
-      //    key               name        default   min      max
-      {KEY_WINDOW_WIDTH,  "windowWidth",  {500},   {300},   {1000}},
-      {KEY_WINDOW_HEIGHT, "windowHeight", {500},   {300},   {1000}},
-      {KEY_FULLSCREEN,    "fullscreen",   {false}, {false}, {true}},
-      {KEY_CLEAR_RED,     "clearRed",     {10},    {0},     {255}},
-      {KEY_CLEAR_GREEN,   "clearGreen",   {10},    {0},     {255}},
-      {KEY_CLEAR_BLUE,    "clearBlue",    {10},    {0},     {255}},
-      {KEY_FPS_LOCK,      "fpsLock",      {60},    {24},    {1000}}
+      //    key                     name                 default  min      max
+      {KEY_WINDOW_WIDTH,        "windowWidth",       {500},   {300},   {1000}},
+      {KEY_WINDOW_HEIGHT,       "windowHeight",      {500},   {300},   {1000}},
+      {KEY_FULLSCREEN,          "fullscreen",        {false}, {false}, {true}},
+      {KEY_CLEAR_RED,           "clearRed",          {10},    {0},     {255}},
+      {KEY_CLEAR_GREEN,         "clearGreen",        {10},    {0},     {255}},
+      {KEY_CLEAR_BLUE,          "clearBlue",         {10},    {0},     {255}},
+      {KEY_FPS_LOCK,            "fpsLock",           {60},    {24},    {1000}},
+      {KEY_WORKER_THREADS,      "workerThreads",     {0},     {0},     {64}},
+      {KEY_DRAW_COMMAND_BUFFER, "drawCommandBuffer", {false}, {false}, {true}},
+      {KEY_HOT_RELOAD,          "hotReload",         {false}, {false}, {true}},
+      {KEY_HEADLESS,            "headless",          {false}, {false}, {true}},
+      {KEY_HEADLESS_FRAMES,     "headlessFrames",    {0},     {0},     {1000000000}},
+      {KEY_HEADLESS_DUMP_PERIOD,"headlessDumpPeriod",{0},     {0},     {1000000000}},
+      {KEY_STATS_LOG_PERIOD,    "statsLogPeriod",    {0},     {0},     {86400}},
+      {KEY_VSYNC,               "vsync",             {false}, {false}, {true}}
     }){}
   };
 
 private:
   void mainloop();
+  void paceFrame();
+  void applyRC();
+  void reloadRC();
+  void pollHotReload();
   void drawEngineStats();
   void drawPauseDialog();
+  void dumpScreens();
+  void updateFrameTimeWindows(Duration_t realNow);
+  void drawFrameTimeGraph();
+  void recordFrameTime(DurationHistogram FrameTimes::* histogram, Duration_t duration);
   void onUpdateTick(float tickPeriodSeconds);
   void onDrawTick(float tickPeriodSeconds);
 
@@ -239,9 +425,9 @@ private:
   void onSplashDrawTick(float tickPeriodSeconds);
   void onSplashExit();
 
-  double durationToMilliseconds(Duration_t d);
-  double durationToSeconds(Duration_t d);
-  double durationToMinutes(Duration_t d);
+  static double durationToMilliseconds(Duration_t d);
+  static double durationToSeconds(Duration_t d);
+  static double durationToMinutes(Duration_t d);
   void durationToDigitalClock(Duration_t d, int& hours, int& mins, int& secs);
 
 private:
@@ -253,6 +439,9 @@ private:
   RealClock _realClock;
   GameClock _gameClock;
 
+  FramePacer _framePacer;
+  bool _isVsyncing;
+
   gfx::Color4f _clearColor;
 
   int _fpsLockHz;
@@ -276,6 +465,38 @@ private:
 
   std::unique_ptr<Game> _game;
 
+  //
+  // Development mode in which changed spritesheets, fonts and the engine rc file are reloaded
+  // whilst running; enabled by the hotReload rc property.
+  //
+  bool _isHotReloading;
+
+  //
+  // Headless run state; see EngineRC. The wall clock start of the run is kept to report the
+  // real time taken, as the real clock is simulated.
+  //
+  bool _isHeadless;
+  int _headlessFrameLimit;
+  int _headlessDumpPeriod;
+  long _headlessFramesDrawn;
+  TimePoint_t _headlessWallStart;
+
+  //
+  // Frame time stats. The stats screen shows the last complete window of statsWindowPeriod plus
+  // the current window, whilst the log period times are logged and reset every statsLogPeriod 
+  // seconds of real time (see EngineRC; 0 for never). The graph is a ring of the last frame 
+  // times, the head being the oldest.
+  //
+  FrameTimes _statsWindowTimes;
+  FrameTimes _lastStatsWindowTimes;
+  FrameTimes _logPeriodTimes;
+  Duration_t _statsWindowStart;
+  Duration_t _logPeriodStart;
+  Duration_t _statsLogPeriod;
+  TimePoint_t _lastDrawStart;
+  std::array<Duration_t, frameTimeGraphSize> _frameTimeGraph;
+  int _frameTimeGraphHead;
+
   bool _isDrawingEngineStats;
   bool _needRedrawEngineStats;
   bool _isDone;
@@ -30,7 +30,15 @@ public:
   virtual ~Scene() = default;
   virtual bool onInit() = 0;
   virtual void onUpdate(double now, float dt) = 0;
-  virtual void onDraw(double now, float dt, const std::vector<gfx::ScreenID_t>& screens) = 0;
+
+  //
+  // Invoked every draw tick. The alpha is the fraction of the next update tick which has 
+  // elapsed, in the range [0, 1]; a scene which draws its moving objects interpolated by the 
+  // alpha between their last two updated states (see Interpolated) moves smoothly even when
+  // drawn more often, or out of step with, updates. Scenes which do not interpolate ignore it.
+  //
+  virtual void onDraw(double now, float dt, float alpha, const std::vector<gfx::ScreenID_t>& screens) = 0;
+
   virtual void onEnter() = 0;
   virtual void onExit() = 0;
 
@@ -72,11 +80,11 @@ public:
   }
 
   //
-  // Invoked by the engine during the draw tick.
+  // Invoked by the engine during the draw tick; see Scene::onDraw for the alpha.
   //
-  void onDraw(double now, float dt)
+  void onDraw(double now, float dt, float alpha)
   {
-    _activeScene->onDraw(now, dt, _screens);
+    _activeScene->onDraw(now, dt, alpha, _screens);
   }
 
   //
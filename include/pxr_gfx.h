@@ -2,6 +2,7 @@
 #define _PIXIRETRO_GFX_H_
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <array>
 #include <cmath>
@@ -29,7 +30,9 @@ constexpr const char* XML_RESOURCE_EXTENSION_SPRITESHEETS = ".spritesheet";
 constexpr const char* XML_RESOURCE_EXTENSION_FONTS = ".font";
 
 //
-// A unique key to identify a gfx resource for use in draw calls.
+// A unique key to identify a gfx resource for use in draw calls. Keys are handles which index 
+// the resource tables directly; keys of unloaded resources are detected as stale rather than
+// resolving to a resource later loaded into the same slot (see pxr_restable.h).
 //
 using ResourceKey_t = int;
 
@@ -107,11 +110,39 @@ struct Font
 // Thus if the origin is in the center of the sprite then the sprite will be drawn centered on the
 // position argument.
 //
+// The row runs base is generated at load time and is the index into the spritesheet's row runs
+// of the sprite's first (bottom) row; see Spritesheet.
+//
 struct Sprite
 {
   Vector2i _position;
   Vector2i _size;
   Vector2i _origin;
+  int _rowRunsBase;
+};
+
+//
+// A horizontal run of opaque (alpha != ALPHA_KEY) pixels within a single row of a sprite. The
+// start is the column of the first pixel of the run w.r.t sprite space, the length is the number
+// of pixels in the run and the pixel offset is the index of the first pixel of the run in the
+// spritesheet's image pixel buffer, i.e. [col + (row * stride)].
+//
+struct SpriteRun
+{
+  int _start;
+  int _length;
+  int _pixelOffset;
+};
+
+//
+// A horizontal run of pixels; the building block of filled shapes and laid out text (see 
+// TextLayout). The position of the first pixel of the span is w.r.t the origin of the shape.
+//
+struct Span
+{
+  int _x;
+  int _y;
+  int _length;
 };
 
 //
@@ -122,10 +153,26 @@ using SpriteID_t = int;
 //
 // A spritesheet organises a bitmap image into sprites.
 //
+// At load time every sprite is encoded into runs of opaque pixels so draw calls can copy whole
+// runs and skip transparent gaps without testing each pixel. The runs of all sprites are stored
+// together, row by row, in _runs. The runs of row r (w.r.t sprite space) of a sprite are then 
+// the half open range:
+//
+//    [_rowRuns[sprite._rowRunsBase + r], _rowRuns[sprite._rowRunsBase + r + 1])
+//
+// thus each sprite has (height + 1) entries in _rowRuns.
+//
+// Copying runs only pays off when runs are long. Sheets whose runs are short on average (e.g.
+// small or dithered sprites) are instead drawn by blitting whole rows with vectorised alpha 
+// keyed copies; the choice is made per sheet when its runs are encoded.
+//
 struct Spritesheet
 {
   io::Bmp _image;
   std::vector<Sprite> _sprites;
+  std::vector<SpriteRun> _runs;
+  std::vector<int> _rowRuns;
+  bool _isKeyedBlit {false};
 };
 
 //
@@ -136,8 +183,11 @@ struct Spritesheet
 //      NO_SHADER - the default. Pixels colors are taken direct from draw call args (either
 //                  an explicit color arg or the gfx resource).
 //
-//      SHADER    - Pixel colors are fed into a user provided shader function along with the
-//                  pixel coordinate. The output color is then drawn to the screen.
+//      SHADER    - Pixel colors are fed into a user provided shader function in spans along
+//                  with the pixel coordinates. The output colors are then drawn to the screen.
+//
+// Each draw routine is compiled separately for each mode so drawing in NO_SHADER mode incurs
+// no per-pixel cost to support shading.
 //
 enum class PixelMode
 {
@@ -200,21 +250,83 @@ enum class PositionMode
 //
 // The signiture of pixel shader functions to be set by the user if using PixelMode::SHADER.
 //
-// The arguments to the shader are:
+// Shaders operate on spans, i.e. horizontal runs of consecutive pixels in a single row of the
+// screen, rather than on individual pixels. This allows a shader to process many pixels per 
+// call and to vectorise its inner loop. The arguments to the shader are:
 //
-//    inColor - the color sampled from the gfx resource or taken the color argument to the
-//              draw call.
+//    span    - the pixels of the span, ordered left to right (ascending x). On input these are
+//              the colors sampled from the gfx resource or taken from the color argument of 
+//              the draw call.
 //
-//    pxx     - the x-axis position of the current pixel being drawn w.r.t the virtual screen 
-//              coordinate space.
+//    count   - the number of pixels in the span.
 //
-//    pxy     - the y-axis position of the current pixel being drawn w.r.t the virtual screen 
-//              coordinate space.
+//    pxx     - the x-axis position of the first pixel in the span w.r.t the virtual screen 
+//              coordinate space; pixel span[i] is at x-axis position (pxx + i).
 //
-// The shader returns a color value it has calculated. The returned color value will replace
-// the input color for the pixel being drawn to the screen at position [pxx, pxy].
+//    pxy     - the y-axis position of the row of the span w.r.t the virtual screen coordinate 
+//              space.
 //
-using PXShader_t = Color4u (*)(Color4u inColor, int pxx, int pxy);
+// The shader writes the colors it has calculated back into the span, in place. The span points
+// directly into the pixels of the screen so the output colors are those drawn to the screen.
+//
+// note: spans only contain pixels which are being drawn, i.e. transparent pixels of sprites and
+// glyphs are never passed to the shader.
+//
+using PXShader_t = void (*)(Color4u* span, int count, int pxx, int pxy);
+
+//
+// The size (width and height) of the tiles used to track the dirty regions of screens; unit
+// is virtual pixels.
+//
+constexpr int SCREEN_TILE_SIZE = 16;
+
+//
+// A draw call recorded for deferred execution when the gfx module is in command buffer mode;
+// see 'enableCommandBuffer'. Commands capture the pixel mode and shader of the screen at the 
+// time they are recorded. Only the members relevant to the type of the command are set.
+//
+// note: commands refer directly to the gfx resources they draw thus resources must not be
+// unloaded between recording and execution of commands.
+//
+class TextLayout;
+
+struct DrawCommand
+{
+  enum class Type
+  {
+    CLEAR,
+    SPRITE,
+    SPRITE_COLUMN,
+    TEXT,
+    TEXT_LAYOUT,
+    BORDER_RECTANGLE,
+    FILL_RECTANGLE,
+    LINE,
+    LINES,
+    POINT
+  };
+
+  Type               _type;
+  PixelMode          _xmode;
+  PXShader_t         _shader;
+  Color4u            _color;       // color of clears, text, rectangles, lines and points.
+  Vector2i           _p0;          // position of sprites, text and points; start of lines.
+  Vector2i           _p1;          // end of lines.
+  iRect              _rect;        // rectangle of rectangles.
+  ResourceKey_t      _resourceKey; // key of the spritesheet or font the resources below are bound from.
+  int                _spriteid;
+  const Spritesheet* _sheet;
+  const Sprite*      _sprite;
+  const Font*        _font;
+  const TextLayout*  _layout;      // layout of text layouts.
+  int                _colid;       // sprite column of sprite columns.
+  bool               _mirrorX;
+  bool               _mirrorY;
+  int                _textOffset;  // offset of the text in the screen's command text.
+  int                _textLength;
+  int                _vertexOffset;// offset of the vertices of line lists in the screen's command vertices.
+  int                _vertexCount;
+};
 
 //
 // A virtual screen of virtual pixels used to create a layer of abstraction from the display
@@ -237,6 +349,14 @@ using PXShader_t = Color4u (*)(Color4u inColor, int pxx, int pxy);
 // skipped. Note that this allows fully transparent pixels drawn in an image editor like GIMP
 // to be omitted when drawing.
 //
+// Screens track which regions of their pixels have been drawn to since the last present. The
+// screen is divided into a grid of square tiles of SCREEN_TILE_SIZE pixels; any draw call marks
+// the tiles it touches as dirty and only dirty tiles are uploaded to the gpu in 'present'.
+//
+// Screens may have a chain of post-process effects which are applied to the final image of the
+// screen in 'present', after all drawing. The drawn pixels are left untouched; the effects 
+// output to a separate post-process buffer which is uploaded in place of the drawn pixels.
+//
 // Further screens can be stacked on top of one another. The draw order (stack order) is 
 // determined by the order in which the screens were created; first created first draw. Any
 // transparent pixels in a screen will allow the corresponding pixel of any screens lower in the 
@@ -255,7 +375,16 @@ struct Screen
   int          _pxManualSize;    // size of virtual pixels when in manual size mode.
   int          _pxCount;         // total number of virtual pixels on the screen.
   Color4u*     _pxColors;        // accessed [col + (row * width)]
-  Vector2i*    _pxPositions;     // accessed [col + (row * width)]
+  Vector2i     _quadPositions[4];// corners of the screen w.r.t window space; ordered for a triangle strip.
+  unsigned int _texture;         // opengl texture the pixel colors are streamed into in 'present'.
+  Vector2i     _tileGrid;        // number of dirty tracking tiles along each axis.
+  uint8_t*     _dirtyTiles;      // accessed [col + (row * _tileGrid._x)]; non-zero if drawn to since last present.
+  int          _pxUploaded;      // number of virtual pixels uploaded in the last present.
+  Color4u*     _ppColors;        // post-processed pixels, accessed as _pxColors; null if no post-processes.
+  std::vector<PXShader_t> _postProcesses; // effects applied in order in 'present'.
+  std::vector<DrawCommand> _commands;     // draw calls recorded in command buffer mode.
+  std::string  _commandText;     // the text of all recorded text commands.
+  std::vector<Vector2i> _commandVertices; // the vertices of all recorded line list commands.
   bool         _isEnabled;       // enable/disable drawing this screen to the window.
 };
 
@@ -264,11 +393,140 @@ struct Screen
 //
 using ScreenID_t = int;
 
+//
+// A list of draw calls recorded once and replayed cheaply many times; intended for static 
+// layers such as backgrounds which would otherwise be redrawn from scratch every frame.
+//
+// A command list has its own canvas of fixed size onto which the recorded draw calls are 
+// rasterised; coordinates of recorded draw calls are w.r.t the canvas. The rasterised canvas is
+// cached and only re-rasterised when the recorded calls change or when gfx resources have been
+// unloaded (or reloaded) since the last rasterisation. Drawing a command list to a screen (see
+// 'drawCommandList') composites the cached canvas into the screen like a sprite, i.e. any pixels
+// of the canvas not drawn to are transparent.
+//
+// Draw calls are recorded unshaded, however the composited canvas is shaded by the shader of 
+// the screen it is drawn to as with any other draw call.
+//
+// note: the command list must outlive any commands recorded in command buffer mode which draw it.
+// Re-rasterising a list which recorded commands still draw flushes the recorded commands first
+// so they draw the old canvas, as they would have if drawn immediately.
+//
+class CommandList
+{
+public:
+  explicit CommandList(Vector2i canvasSize);
+  ~CommandList();
+
+  CommandList(const CommandList&) = delete;
+  CommandList& operator=(const CommandList&) = delete;
+
+  //
+  // Removes all recorded draw calls.
+  //
+  void clear();
+
+  //
+  // Record a draw call; see the draw functions below for details of each call.
+  //
+  void drawSprite(Vector2i position, ResourceKey_t sheetKey, SpriteID_t spriteid, 
+                  bool mirrorX = false, bool mirrorY = false);
+  void drawSpriteColumn(Vector2i position, ResourceKey_t sheetKey, SpriteID_t spriteid, int colid);
+  void drawText(Vector2i position, const std::string& text, ResourceKey_t fontKey, Color4u color);
+  void drawBorderRectangle(iRect rect, Color4u color);
+  void drawFillRectangle(iRect rect, Color4u color);
+  void drawLine(Vector2i p0, Vector2i p1, Color4u color);
+  void drawLines(const std::vector<Vector2i>& vertices, Color4u color);
+  void drawPoint(Vector2i position, Color4u color);
+
+  Vector2i getCanvasSize() const {return _canvas._resolution;}
+  int getCommandCount() const {return _commands.size();}
+
+private:
+  void record(DrawCommand& command, const std::string& text = {}, 
+              const std::vector<Vector2i>& vertices = {});
+  void rasterise();
+
+  friend void drawCommandList(Vector2i position, CommandList& list, ScreenID_t screenid);
+
+private:
+  std::vector<DrawCommand> _commands;
+  std::string _text;
+  std::vector<Vector2i> _vertices;
+  Screen _canvas;
+  Spritesheet _cache;
+  long _rasterisedGeneration;
+  long _recordedFlush;      // the flush which will execute the last recorded draw of the list.
+  bool _isRasterised;
+};
+
+//
+// A block of text laid out once and drawn cheaply many times; intended for text which changes
+// rarely relative to how often it is drawn, such as HUD labels.
+//
+// Laying out text walks its glyphs to find the opaque pixel spans of every glyph row w.r.t the
+// bottom-left of the text block, merging spans which touch. Drawing the layout then just fills
+// the spans with the text color. The layout is recomputed lazily (on the next draw or update) 
+// only when the text or font is changed, or when gfx resources have been unloaded or reloaded 
+// since it was laid out; setting the same text again does no work.
+//
+// Text may span multiple lines separated by '\n'; lines are laid out top to bottom, 
+// Font::_lineHeight apart, with the bottom line on the bottom of the block.
+//
+// note: the layout must outlive, and not be changed before the execution of, any commands 
+// recorded in command buffer mode which draw it.
+//
+class TextLayout
+{
+public:
+  TextLayout();
+  TextLayout(std::string_view text, ResourceKey_t fontKey);
+
+  void setText(std::string_view text);
+  void setFont(ResourceKey_t fontKey);
+
+  const std::string& getText() const {return _text;}
+  ResourceKey_t getFontKey() const {return _fontKey;}
+
+  //
+  // Lays out the text if the layout is stale; the draw calls update the layout before drawing.
+  //
+  void update();
+
+  //
+  // Accessors to the layout as of the last update. The size is that of the text block as 
+  // calculateTextSize would return, the spans are ordered by row then column and the bounds are
+  // those of the spans w.r.t the bottom-left of the text block.
+  //
+  Vector2i getSize() const {return _size;}
+  const std::vector<Span>& getSpans() const {return _spans;}
+  iRect getBounds() const {return _bounds;}
+
+private:
+  std::string _text;
+  ResourceKey_t _fontKey;
+  std::vector<Span> _spans;
+  iRect _bounds;
+  Vector2i _size;
+  long _layoutGeneration;
+  bool _isLaidOut;
+};
+
 //
 // Initializes the gfx subsystem. Returns true if success and false if fatal error.
 //
 bool initialize(std::string windowTitle, Vector2i windowSize, bool fullscreen);
 
+//
+// Initializes the gfx subsystem without a window or opengl context; for running the software 
+// rasteriser where there is no display or gpu, e.g. benchmarks and golden image tests on build
+// machines. Screens are kept in memory only and are laid out within a notional window of the 
+// given size. Presenting applies the post-processes to the dirty regions of the screens but 
+// uploads nothing; see dumpScreen to save the results.
+//
+bool initializeHeadless(Vector2i windowSize);
+
+bool isHeadless();
+
 //
 // Call to shutdown the module upon app termination.
 //
@@ -293,6 +551,13 @@ ScreenID_t createScreen(Vector2i resolution);
 //
 void onWindowResize(Vector2i windowSize);
 
+//
+// Enables or disables syncing presents to the display's vertical refresh, upon which presents
+// wait for the next refresh. Returns whether presents are now synced; false if vsync is not
+// supported by the driver, and always in headless mode.
+//
+bool setVsync(bool isEnabled);
+
 //
 // Loads a spritesheet from RESOURCE_PATH_SPRITESHEET directory in the file system.
 //
@@ -342,6 +607,87 @@ ResourceKey_t loadFont(ResourceName_t name);
 //
 void unloadFont(ResourceKey_t fontKey);
 
+//
+// Read a spritesheet or font from its asset files, validating it (and for spritesheets encoding
+// the sprite runs), without loading it into the module; the module need not be initialized.
+// Returns false if the files are missing or invalid. Used by the pxrpak asset packer; games
+// should call the load functions.
+//
+// note: the load functions read resources from the open asset archive (see pxr_pak.h) if it
+// contains them, falling back to the asset files if not.
+//
+bool readSpritesheet(ResourceName_t name, Spritesheet& sheet);
+bool readFont(ResourceName_t name, Font& font);
+
+//
+// Asynchronous variants of the load functions. The files are read and decoded on the worker 
+// threads (see pxr_worker.h) and the returned key is usable immediately, resolving to the error
+// spritesheet/font until the load completes, and to the error resource for good if the load 
+// fails. Completed loads are published at the end of each call to present.
+//
+// Loading (synchronously or not) a resource which is still loading returns its pending key.
+// Unloading works the same as for synchronous loads, including whilst the load is in flight.
+//
+ResourceKey_t loadSpritesheetAsync(ResourceName_t name);
+ResourceKey_t loadFontAsync(ResourceName_t name);
+
+bool isSpritesheetLoading(ResourceKey_t sheetKey);
+bool isFontLoading(ResourceKey_t fontKey);
+
+//
+// Re-reads a loaded spritesheet or font from its asset files on the worker threads, bypassing 
+// the asset archive, for hot reloading edited assets. The new data replaces the data of the 
+// resource when the reload completes (at the end of a call to present) thus existing keys remain
+// valid. A failed reload leaves the resource unchanged. Returns false if no resource of the name
+// is loaded.
+//
+// Reloads count as asynchronous loads in getAsyncLoadCount and getAsyncLoadProgress.
+//
+bool reloadSpritesheet(ResourceName_t name);
+bool reloadFont(ResourceName_t name);
+
+//
+// Statistics of a call to packSpritesheets. Occupancy is the fraction [0, 1] of the pixels of
+// the new pages covered by sprites. The bytes are the pixel memory owned by the packed sheets' 
+// images before packing and by the new pages after; the memory saved is the difference. Images
+// viewing the asset archive or an earlier page own no memory, thus packing them costs memory.
+//
+struct AtlasStats
+{
+  int _sheetCount;
+  int _pageCount;
+  float _occupancy;
+  std::size_t _bytesBefore;
+  std::size_t _bytesAfter;
+};
+
+//
+// Packs the sprites of loaded spritesheets into shared atlas pages, rewriting the sprite 
+// positions (and runs) of the sheets to point into the pages. Sprites are cropped from their 
+// sheets so the unused space of the sheets is dropped, and the sprites of sheets used together
+// sit together in memory. Keys remain valid and drawing is unchanged.
+//
+// Sheets are packed in the order given; pass the sheets of a level or scene together. All the
+// sprites of a sheet go on the same page. Sheets still loading, the error spritesheet and sheets 
+// which do not fit on a page are skipped. Repacking a sheet moves it to a new page.
+//
+// note: the images of packed sheets are views into the pages thus read only; reloading a packed
+// sheet (see reloadSpritesheet) unpacks it.
+//
+AtlasStats packSpritesheets(const std::vector<ResourceKey_t>& sheetKeys);
+
+//
+// Returns the number of asynchronous loads in flight.
+//
+int getAsyncLoadCount();
+
+//
+// Returns the fraction [0, 1] of the asynchronous loads started since there were last none in 
+// flight which have completed; for progress bars on loading screens. Returns 1 if there are no
+// loads in flight.
+//
+float getAsyncLoadProgress();
+
 //
 // Read only access to a font's data structure.
 //
@@ -392,10 +738,23 @@ void drawSprite(Vector2i position, ResourceKey_t sheetKey, SpriteID_t spriteid,
 void drawSpriteColumn(Vector2i position, ResourceKey_t sheetKey, SpriteID_t spriteid, int colid, ScreenID_t screenid);
 
 // 
-// Draw a text string.
+// Draw a text string with the bottom-left of the text block at position. Lines are separated 
+// by '\n'; see TextLayout.
+//
+// Fonts are pre-tinted to the colors they are drawn in and the tinted glyphs drawn like sprites,
+// copying runs of opaque pixels. The tinted fonts are kept in a small least-recently-used cache
+// so text drawn repeatedly in a few colors (e.g. HUDs) is tinted only once; see 
+// getFontCacheStats. Colors are tinted from their second use, so text whose color changes every
+// frame is drawn untinted, as is text with a fully transparent color.
 //
 void drawText(Vector2i position, const std::string& text, ResourceKey_t fontKey, Color4u color, ScreenID_t screenid);
 
+//
+// Draws laid out text with the bottom-left of the text block at position; the result is the same
+// as drawText. Lays out the text first if the layout is stale.
+//
+void drawTextLayout(Vector2i position, TextLayout& layout, Color4u color, ScreenID_t screenid);
+
 //
 // Draw a border rectangle, i.e draw only the outline. This function clamps the rectangle to 
 // within the screen boundary.
@@ -408,17 +767,62 @@ void drawBorderRectangle(iRect rect, Color4u color, ScreenID_t screenid);
 void drawFillRectangle(iRect rect, Color4u color, ScreenID_t screenid);
 
 //
-// Draw a line.
+// Draw a line. Both end points are drawn. Lines are clipped to the screen boundary without 
+// changing their slope, i.e. only the pixels of the line within the screen are drawn.
 //
 void drawLine(Vector2i p0, Vector2i p1, Color4u color, ScreenID_t screenid);
 
+//
+// Draw a list of lines; each pair of vertices (v0,v1), (v2,v3), ... is a line, as drawLine. Any
+// unpaired last vertex is ignored. Drawing many lines this way costs a single draw call.
+//
+void drawLines(const std::vector<Vector2i>& vertices, Color4u color, ScreenID_t screenid);
+
 //
 // Draws a single pixel to a screen.
 //
 void drawPoint(Vector2i position, Color4u color, ScreenID_t screenid);
 
+//
+// Draws the (cached) rasterised canvas of a command list to a screen with the bottom-left of the
+// canvas at position. Rasterises the canvas first if the cache is stale.
+//
+void drawCommandList(Vector2i position, CommandList& list, ScreenID_t screenid);
+
+//
+// Enables command buffer mode. In command buffer mode draw (and clear) calls do not draw to 
+// screens immediately but are instead recorded in a per screen command buffer. The recorded
+// commands are executed in 'flushCommands' (which is called by 'present') in parallel by the
+// worker pool (see pxr_worker.h).
+//
+// Each screen is divided into horizontal bands of rows with each band drawn by a single thread;
+// the thread executes all commands of the screen in the order they were recorded, clipped to its
+// band. Thus there are no write conflicts between threads and the result is identical to that of
+// drawing immediately. Bands are aligned to the dirty tiles of the screen.
+//
+// Note that pixel shaders are then run concurrently on the worker threads, so must not write
+// to shared state. Commands point to the resources they draw, thus unloading a spritesheet or 
+// font (or packing spritesheets) flushes the recorded commands first.
+//
+void enableCommandBuffer();
+
+//
+// Flushes any recorded commands and disables command buffer mode.
+//
+void disableCommandBuffer();
+
+//
+// Executes and then clears all commands recorded in command buffer mode; a no-op if none have
+// been recorded.
+//
+void flushCommands();
+
 //
 // Issues opengl calls to render results of (software) draw calls and then swaps the buffers.
+// Any commands recorded in command buffer mode are flushed first.
+//
+// Each enabled screen is uploaded to its own streaming texture and drawn as a single nearest
+// filtered quad, thus the cost of presenting a screen is one texture upload and one draw call.
 //
 void present();
 
@@ -453,6 +857,38 @@ void setScreenManualPixelSize(int pxSize, ScreenID_t screenid);
 //
 void setPixelShader(PXShader_t shader, ScreenID_t screenid);
 
+//
+// Appends a post-process effect to the end of the post-process chain of a screen. Effects share
+// the span signiture of pixel shaders but are run once per frame in 'present' over the final 
+// image of the screen, in the order they were added, rather than inside each draw call. Thus 
+// overdrawn pixels are only processed once and each effect receives the output of the last.
+//
+// Effects are run only over the dirty regions of a screen (see Screen) and so must be pure 
+// functions of the span colors and coordinates. Spans are always entire rows of a dirty 
+// region and rows are processed independently of one another, in parallel on the worker 
+// threads. Effects should not change the alpha channel which is used for screen transparency.
+//
+void addScreenPostProcess(PXShader_t effect, ScreenID_t screenid);
+
+//
+// Removes all post-process effects from a screen.
+//
+void clearScreenPostProcesses(ScreenID_t screenid);
+
+//
+// Built-in post-process effects:
+//
+//    postProcessScanlines      - halves the brightness of every odd row of pixels.
+//
+//    postProcessCrtTint        - tints pixels toward the green phosphor glow of old CRTs.
+//
+//    postProcessGameboyPalette - remaps pixels to the 4 shades of green of the original 
+//                                Nintendo Gameboy by luminance.
+//
+void postProcessScanlines(Color4u* span, int count, int pxx, int pxy);
+void postProcessCrtTint(Color4u* span, int count, int pxx, int pxy);
+void postProcessGameboyPalette(Color4u* span, int count, int pxx, int pxy);
+
 //
 // Enables a screen so it will be rendered to the window.
 //
@@ -463,20 +899,59 @@ void enableScreen(ScreenID_t screenid);
 //
 void disableScreen(ScreenID_t screenid);
 
+int getScreenCount();
+
+bool isScreenEnabled(ScreenID_t screenid);
+
+//
+// Writes the pixels of a screen as presented (i.e. post-processed) in the last call to 
+// 'present' to a 32 bit bmp file. Returns false if the file cannot be written.
+//
+bool dumpScreen(ScreenID_t screenid, const std::string& filepath);
+
+//
+// Per-frame stat: the fraction [0,1] of a screen's pixels which were dirty and thus uploaded to
+// the gpu in the last call to 'present'. Disabled screens are not presented so they retain their
+// dirty regions (and their ratio) until enabled again.
+//
+float getScreenDirtyRatio(ScreenID_t screenid);
+
+//
+// Per-frame stat: the fraction [0,1] of the pixels of all enabled screens which were uploaded to
+// the gpu in the last call to 'present'.
+//
+float getDirtyRatio();
+
+//
+// Statistics of the cache of tinted fonts used by drawText. Hits and misses are counted since 
+// initialization.
+//
+struct FontCacheStats
+{
+  long _hits;
+  long _misses;
+  int _entryCount;
+  int _capacity;
+};
+
+FontCacheStats getFontCacheStats();
+
 //
 // Utility function for calculating the dimensions of the smallest possible bounding box of 
-// a text string for a given font. Dimensions are in units of virtual pixels.
+// a text string for a given font. Dimensions are in units of virtual pixels. The width is that 
+// of the widest line and each line after the first adds Font::_lineHeight to the height.
 //
 Vector2i calculateTextSize(const std::string& text, ResourceKey_t fontKey);
 
 //
 // Utility to test if a spritesheet resource key is associated with the error spritesheet. Allows 
-// testing if a spritesheet load failed.
+// testing if a spritesheet load failed. Returns false for asynchronous loads still in flight.
 //
 bool isErrorSpritesheet(ResourceKey_t sheetKey);
 
 //
-// Utility to access the size of a spritesheet.
+// Utility to access the size of a spritesheet. For spritesheets packed into an atlas this is the
+// size of the atlas page.
 //
 Vector2i getSpritesheetSize(ResourceKey_t sheetKey);
 
@@ -95,9 +95,8 @@ public:
     void onDraw(gfx::ScreenID_t screenid);
 
   private:
-    gfx::ResourceKey_t _fontKey;
     std::string _fullText;
-    std::string _visibleText;
+    gfx::TextLayout _layout;        // layout of the visible text.
     long _lastPhaseInNo;
     int _nextCharToShow;
     bool _isPhasingIn;
@@ -127,11 +126,10 @@ public:
     void composeDisplayStr();
 
   private:
-    gfx::ResourceKey_t _fontKey;
     const int& _sourceValue;
     int _displayValue;
     int _precision;
-    std::string _displayStr;
+    gfx::TextLayout _layout;
   };
 
   class BitmapLabel final : public Label
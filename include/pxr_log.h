@@ -25,6 +25,14 @@ LOGSTR msg_eng_fail_sdl_init = "failed to initialize SDL";
 LOGSTR msg_eng_locking_fps = "locking fps to";
 LOGSTR msg_eng_fail_load_splash = "failed to splash sprite : skipping splash screen";
 LOGSTR msg_eng_fail_init_game = "failed to initialize the game";
+LOGSTR msg_eng_hot_reload = "hot reloading enabled : watching asset directories";
+LOGSTR msg_eng_fail_hot_reload = "failed to watch asset directories : hot reloading disabled";
+LOGSTR msg_eng_reloaded_rc = "reloaded engine rc file";
+LOGSTR msg_eng_rc_needs_restart = "changed window, worker, hot reload or headless rc properties take effect on restart";
+LOGSTR msg_eng_headless = "running headless with a simulated clock";
+LOGSTR msg_eng_headless_done = "headless run complete";
+LOGSTR msg_eng_fail_create_dump_dir = "failed to create the headless screen dump directory";
+LOGSTR msg_eng_frame_times = "frame times";
 
 //
 // gfx log strings.
@@ -41,22 +49,38 @@ LOGSTR msg_gfx_fail_set_opengl_attribute = "failed to set opengl attribute";
 LOGSTR msg_gfx_opengl_version = "using opengl version";
 LOGSTR msg_gfx_opengl_renderer = "using opengl renderer";
 LOGSTR msg_gfx_opengl_vendor = "using opengl vendor";
+LOGSTR msg_gfx_vsync = "syncing presents to the display refresh";
+LOGSTR msg_gfx_fail_vsync = "failed to enable vsync : pacing frames without it";
 LOGSTR msg_gfx_loading_spritesheets = "starting spritesheet loading";
 LOGSTR msg_gfx_loading_spritesheet = "loading spritesheet";
 LOGSTR msg_gfx_spritesheet_already_loaded = "spritesheet already loaded";
 LOGSTR msg_gfx_loading_spritesheet_success = "successfully loaded spritesheet";
+LOGSTR msg_gfx_spritesheet_runs = "encoded spritesheet opaque runs";
 LOGSTR msg_gfx_loading_font = "loading font";
 LOGSTR msg_gfx_loading_font_success = "successfully loaded font";
+LOGSTR msg_gfx_loading_spritesheet_async = "loading spritesheet asynchronously";
+LOGSTR msg_gfx_loading_font_async = "loading font asynchronously";
+LOGSTR msg_gfx_async_load_success = "asynchronous load complete";
+LOGSTR msg_gfx_async_load_fail = "asynchronous load failed : resource will resolve to the error resource";
+LOGSTR msg_gfx_reloading_spritesheet = "reloading spritesheet";
+LOGSTR msg_gfx_reloading_font = "reloading font";
+LOGSTR msg_gfx_reload_fail = "reload failed : keeping the loaded resource";
+LOGSTR msg_gfx_atlas_packed = "packed spritesheets into atlas pages";
+LOGSTR msg_gfx_headless = "running headless : no window, screens are kept in memory";
+LOGSTR msg_gfx_fail_dump_screen = "failed to dump screen";
+LOGSTR msg_gfx_atlas_skipped_sheet = "spritesheet does not fit on an atlas page : not packed";
 LOGSTR msg_gfx_fail_load_asset_bmp = "failed to load the bitmap image of asset";
 LOGSTR msg_gfx_using_error_spritesheet = "substituting unloaded spritesheet with error spritesheet";
 LOGSTR msg_gfx_using_error_font = "substituting unloaded font with error font";
 LOGSTR msg_gfx_loading_fonts = "starting font loading";
 LOGSTR msg_gfx_pixel_size_range = "range of valid pixel sizes";
+LOGSTR msg_gfx_max_texture_size = "max screen resolution (texture size)";
 LOGSTR msg_gfx_created_vscreen = "created vscreen";
 LOGSTR msg_gfx_missing_ascii_glyphs = "loaded font does not contain glyphs for all 95 printable ascii chars";
 LOGSTR msg_gfx_font_fail_checksum = "loaded font failed the checksum test; may be duplicate ascii chars";
 LOGSTR msg_gfx_spritesheet_invalid_xml_bmp_mismatch = "invalid spritesheet : xml data implies a different bitmap size";
 LOGSTR msg_gfx_font_invalid_xml_bmp_mismatch = "invalid font : char xml meta extends font bmp bounds";
+LOGSTR msg_gfx_invalid_archive_entry = "invalid asset archive entry : loading from file instead";
 LOGSTR msg_gfx_unloading_nonexistent_resource = "trying to unload nonexistent resource";
 LOGSTR msg_gfx_unload_spritesheet_success = "successfully unloaded spritesheet";
 LOGSTR msg_gfx_unload_font_success = "successfully unloaded font";
@@ -81,6 +105,7 @@ LOGSTR msg_sfx_using_error_sound = "using error sound to substitute sound";
 LOGSTR msg_sfx_no_error_music = "unloaded music is substituted with silence";
 LOGSTR msg_sfx_error_sound_usage = "error sound usage count";
 LOGSTR msg_sfx_load_sound_success = "successfully loaded sound";
+LOGSTR msg_sfx_loading_sound_async = "loading sound asynchronously";
 LOGSTR msg_sfx_load_music_success = "successfully loaded music";
 LOGSTR msg_sfx_unloading_nonexistent_sound = "trying to unload nonexistent sound with sound key";
 LOGSTR msg_sfx_unloading_nonexistent_music = "trying to unload nonexistent music with music key";
@@ -101,6 +126,41 @@ LOGSTR msg_xml_fail_read_element = "failed to find xml element";
 LOGSTR msg_xml_tinyxml_error_name = "tinyxml2 error name";
 LOGSTR msg_xml_tinyxml_error_desc = "tinyxml2 error desc";
 
+//
+// worker log strings.
+//
+
+LOGSTR msg_wkr_started_workers = "started worker threads: count";
+
+//
+// watch log strings.
+//
+
+LOGSTR msg_wch_fail_init = "failed to initialize inotify";
+LOGSTR msg_wch_fail_add = "failed to watch directory";
+LOGSTR msg_wch_overflow = "file change events overflowed : some changes were missed";
+
+//
+// profiler log strings.
+//
+
+LOGSTR msg_prf_exported = "exported profile trace";
+LOGSTR msg_prf_fail_export = "failed to write profile trace";
+
+//
+// pak log strings.
+//
+
+LOGSTR msg_pak_opened = "opened asset archive";
+LOGSTR msg_pak_no_archive = "no asset archive found : loading assets from files";
+LOGSTR msg_pak_fail_map = "failed to memory map asset archive";
+LOGSTR msg_pak_corrupted = "asset archive corrupted or wrong type";
+LOGSTR msg_pak_wrong_version = "asset archive has unsupported version; repack the assets";
+LOGSTR msg_pak_packing = "packing asset";
+LOGSTR msg_pak_fail_pack = "failed to pack asset : skipping";
+LOGSTR msg_pak_fail_write = "failed to write asset archive";
+LOGSTR msg_pak_written = "wrote asset archive";
+
 //
 // cutscene log strings.
 //
@@ -116,6 +176,7 @@ LOGSTR msg_bmp_corrupted = "expected a bitmap image file; file corrupted or wron
 LOGSTR msg_bmp_unsupported_colorspace = "loaded bitmap image using unsupported non-sRGB color space";
 LOGSTR msg_bmp_unsupported_compression = "loaded bitmap image using unsupported compression mode";
 LOGSTR msg_bmp_unsupported_size = "loaded bitmap image has unsupported size";
+LOGSTR msg_bmp_fail_write = "failed to write bitmap image file";
 
 //
 // wav file log strings.
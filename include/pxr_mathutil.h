@@ -15,6 +15,42 @@ inline T wrap(T value, T lo, T hi)
   return (value < lo) ? hi : (value > hi) ? lo : value;
 }
 
+//
+// Interpolates from v0 to v1 by the fraction alpha; unlike lerp works for vectors.
+//
+template<typename T>
+inline T interpolate(const T& v0, const T& v1, float alpha)
+{
+  return v0 + ((v1 - v0) * alpha);
+}
+
+//
+// A value, e.g. a position, which is changed in update ticks and drawn interpolated between its
+// last two values by the alpha passed to Scene::onDraw. Drawn values thus lag one update tick
+// behind the latest value.
+//
+// Set the value once per update tick; reset it to jump to a value without interpolating, e.g.
+// when spawning or teleporting.
+//
+template<typename T>
+class Interpolated
+{
+public:
+  Interpolated() : _previous{}, _current{} {}
+  explicit Interpolated(const T& value) : _previous{value}, _current{value} {}
+
+  void set(const T& value){_previous = _current; _current = value;}
+  void reset(const T& value){_previous = _current = value;}
+
+  const T& get() const {return _current;}
+  const T& getPrevious() const {return _previous;}
+  T get(float alpha) const {return interpolate(_previous, _current, alpha);}
+
+private:
+  T _previous;
+  T _current;
+};
+
 } // namespace pxr
 
 #endif
@@ -0,0 +1,78 @@
+#ifndef _PIXIRETRO_NAME_H_
+#define _PIXIRETRO_NAME_H_
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <cstdint>
+
+namespace pxr
+{
+namespace name
+{
+
+//
+// A registry of interned names.
+//
+// Interning a name maps it to a unique integer id; interning the same name again returns the 
+// same id. Resource names can thus be compared and hashed as ids rather than as strings. The
+// interned strings are never freed so ids remain valid for the lifetime of the program.
+//
+// note: the registry is not thread safe; names must be interned from the main thread.
+//
+
+using NameID_t = int32_t;
+
+static constexpr NameID_t nullNameID {-1};
+
+//
+// Returns the id of a name, interning the name if it has not been interned before.
+//
+NameID_t intern(std::string_view name);
+
+//
+// Returns the id of a name if it has been interned, else nullNameID. Never interns the name.
+//
+NameID_t find(std::string_view name);
+
+//
+// Returns the string of an interned name.
+//
+const std::string& getString(NameID_t nameid);
+
+//
+// Returns the number of names interned.
+//
+int getCount();
+
+//
+// A hash map from interned name ids to resource keys; used by the resource modules to find 
+// resources which are already loaded by name.
+//
+template<typename Key_t>
+class KeyMap
+{
+public:
+  static constexpr Key_t nullKey {-1};
+
+  //
+  // Returns the key mapped to a name, or nullKey if the name is not mapped.
+  //
+  Key_t find(NameID_t nameid) const
+  {
+    auto search = _keys.find(nameid);
+    return search == _keys.end() ? nullKey : search->second;
+  }
+
+  void insert(NameID_t nameid, Key_t key) {_keys[nameid] = key;}
+  void erase(NameID_t nameid) {_keys.erase(nameid);}
+  void clear() {_keys.clear();}
+
+private:
+  std::unordered_map<NameID_t, Key_t> _keys;
+};
+
+} // namespace name
+} // namespace pxr
+
+#endif
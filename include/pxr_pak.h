@@ -0,0 +1,179 @@
+#ifndef _PIXIRETRO_PAK_H_
+#define _PIXIRETRO_PAK_H_
+
+#include <cstdint>
+#include <string_view>
+
+namespace pxr
+{
+namespace pak
+{
+
+//
+// A packed asset archive; a single file holding all the assets of a game in a form which can be
+// used in place without parsing, decoding or validation.
+//
+// Archives are generated offline by the pxrpak tool from the assets/ tree and memory mapped at
+// runtime. The gfx and sfx loaders look for resources in the open archive before falling back
+// to the individual asset files, so an archive is optional and games need no changes to use one.
+//
+// Archive layout:
+//
+//    [Header][entry data ...][Entry table]
+//
+// The data of each entry starts aligned to DATA_ALIGNMENT bytes within the file, and since the
+// mapping of the file starts page aligned, the data is equally aligned in memory.
+//
+// Spritesheet entry data:
+//
+//    [SpritesheetRecord][SpriteRecord x spriteCount][RunRecord x runCount]
+//    [int32_t rowRuns x rowRunCount][pad][pixels]
+//
+// Font entry data:
+//
+//    [FontRecord][GlyphRecord x ASCII_CHAR_COUNT][pad][pixels]
+//
+// Sound and music entry data is the complete wav file.
+//
+// Pixels are stored decoded in the in-memory format of io::Bmp: Color4u rows ordered bottom to
+// top, each row padded to a stride which is a multiple of Bmp::PIXEL_ALIGNMENT, and the pixels
+// start aligned to Bmp::PIXEL_ALIGNMENT. All integers are stored in the byte order of the host
+// which packed the archive; archives are thus not portable between hosts of different endianness.
+//
+// The offsets in records are w.r.t the start of the data of the entry the record belongs to.
+//
+
+//
+// The path the engine opens the archive from w.r.t the app root directory.
+//
+static constexpr const char* ARCHIVE_PATH {"assets/assets.pak"};
+
+static constexpr uint32_t ARCHIVE_MAGIC {0x50525850};   // "PXRP" in little endian.
+
+//
+// Increment whenever the archive layout or any record changes; archives of other versions are
+// rejected.
+//
+static constexpr uint32_t ARCHIVE_VERSION {1};
+
+static constexpr int DATA_ALIGNMENT {64};
+static constexpr int NAME_MAX_LENGTH {56};
+
+enum class EntryType : uint32_t
+{
+  SPRITESHEET,
+  FONT,
+  SOUND,
+  MUSIC,
+  COUNT
+};
+
+struct Header
+{
+  uint32_t _magic;
+  uint32_t _version;
+  uint32_t _entryCount;
+  uint32_t _reserved;
+  uint64_t _entryTableOffset;
+};
+
+struct Entry
+{
+  char _name[NAME_MAX_LENGTH];   // null terminated.
+  EntryType _type;
+  uint32_t _reserved;
+  uint64_t _offset;
+  uint64_t _size;
+};
+
+struct ImageRecord
+{
+  int32_t _width;
+  int32_t _height;
+  int32_t _stride;
+  uint32_t _pixelsOffset;
+};
+
+struct SpritesheetRecord
+{
+  ImageRecord _image;
+  int32_t _spriteCount;
+  int32_t _runCount;
+  int32_t _rowRunCount;
+  uint32_t _spritesOffset;
+  uint32_t _runsOffset;
+  uint32_t _rowRunsOffset;
+};
+
+struct SpriteRecord
+{
+  int32_t _x;
+  int32_t _y;
+  int32_t _w;
+  int32_t _h;
+  int32_t _ox;
+  int32_t _oy;
+  int32_t _rowRunsBase;
+};
+
+struct RunRecord
+{
+  int32_t _start;
+  int32_t _length;
+  int32_t _pixelOffset;
+};
+
+struct FontRecord
+{
+  ImageRecord _image;
+  int32_t _lineHeight;
+  int32_t _baseLine;
+  int32_t _glyphSpace;
+  int32_t _glyphCount;
+  uint32_t _glyphsOffset;
+};
+
+struct GlyphRecord
+{
+  int32_t _ascii;
+  int32_t _x;
+  int32_t _y;
+  int32_t _width;
+  int32_t _height;
+  int32_t _xoffset;
+  int32_t _yoffset;
+  int32_t _xadvance;
+};
+
+//
+// Memory maps an archive and validates its header and entry table. Returns false if the archive
+// does not exist or is invalid, in which case no archive is open. Any archive already open is
+// closed first.
+//
+bool open(const char* path = ARCHIVE_PATH);
+
+//
+// Unmaps the open archive. Resources loaded from the archive reference the mapped memory thus
+// must be unloaded (or no longer used) before closing.
+//
+void close();
+
+bool isOpen();
+
+//
+// Returns the entry of a resource in the open archive, or nullptr if there is no open archive
+// or the archive does not contain the resource.
+//
+const Entry* find(EntryType type, std::string_view name);
+
+//
+// Returns a pointer to the start of the data of an entry.
+//
+// note: the mapping is private and writable; writes are copy-on-write and never reach the file.
+//
+uint8_t* getData(const Entry& entry);
+
+} // namespace pak
+} // namespace pxr
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef _PIXIRETRO_PROF_H_
+#define _PIXIRETRO_PROF_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace pxr
+{
+namespace prof
+{
+
+//
+// A lightweight frame profiler.
+//
+// A block of code is timed by placing a scope at its top, usually with the PXR_PROFILE_SCOPE
+// macro. When the scope ends its start time and duration are recorded as an event in a ring
+// buffer belonging to the thread it ran on, so recording takes no locks; each thread keeps its
+// last EVENTS_PER_THREAD events, older events being overwritten.
+//
+// The engine marks the start of every frame (see beginFrame) upon which the events of the frame
+// just done are summed per scope name into a breakdown shown on the engine stats screen. All
+// buffered events can also be exported as a Chrome trace to be viewed in chrome://tracing or
+// https://ui.perfetto.dev.
+//
+// Scope names must be string literals (or otherwise outlive the profiler) as only the pointer
+// is recorded.
+//
+// note: the profiler is enabled by default; when disabled scopes cost a single branch.
+//
+
+static constexpr int EVENTS_PER_THREAD {1 << 13};
+
+struct Event
+{
+  const char* _name;
+  int64_t _start;      // unit: ns since the profiler epoch (program start).
+  int64_t _duration;   // unit: ns.
+  int _depth;          // number of scopes the scope was nested within on its thread.
+};
+
+class Scope
+{
+public:
+  explicit Scope(const char* name);
+  ~Scope();
+
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+
+private:
+  const char* _name;
+  int64_t _start;
+};
+
+//
+// The total time spent in all scopes of a name (on all threads) in a frame. Totals include
+// the time spent in any nested scopes.
+//
+struct ScopeTotal
+{
+  const char* _name;
+  int64_t _duration;   // unit: ns.
+  int _count;
+};
+
+void enable();
+void disable();
+bool isEnabled();
+
+//
+// Names the calling thread in exported traces; unnamed threads are named by number.
+//
+void setThreadName(const char* name);
+
+//
+// Marks the start of a new frame, ending the last. Scopes are counted in the frame they started
+// in. Must be called from one thread only; the engine calls it at the start of every frame.
+//
+void beginFrame();
+
+//
+// Returns the breakdown of the last frame, ordered by duration descending, and the duration of
+// the frame.
+//
+const std::vector<ScopeTotal>& getFrameBreakdown();
+int64_t getFrameDuration();
+
+//
+// Writes all buffered events of all threads to a Chrome trace event format (json) file. Returns
+// false if the file cannot be written.
+//
+// note: events recorded whilst exporting may or may not be included.
+//
+bool exportChromeTrace(const std::string& filepath);
+
+} // namespace prof
+} // namespace pxr
+
+#define PXR_PROFILE_CONCAT_IMPL(a, b) a##b
+#define PXR_PROFILE_CONCAT(a, b) PXR_PROFILE_CONCAT_IMPL(a, b)
+
+//
+// Times the rest of the enclosing block as a scope of the given name.
+//
+#define PXR_PROFILE_SCOPE(name) ::pxr::prof::Scope PXR_PROFILE_CONCAT(pxrProfileScope, __LINE__){name}
+
+#endif
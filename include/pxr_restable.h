@@ -0,0 +1,127 @@
+#ifndef _PIXIRETRO_RESTABLE_H_
+#define _PIXIRETRO_RESTABLE_H_
+
+#include <deque>
+#include <vector>
+#include <cstdint>
+#include <cassert>
+#include <utility>
+
+namespace pxr
+{
+
+//
+// A table of resources indexed by generational handles.
+//
+// Each handle (key) encodes the index of the slot holding the resource in its low bits and
+// the generation of the slot in its high bits. Slots are reused after their resource is
+// removed, and the generation of the slot is incremented on removal so that keys to the removed
+// resource can be detected as stale rather than silently resolving to whatever resource is later
+// stored in the reused slot.
+//
+// Lookups are a single index into the slot array. The checked lookup (find) validates the
+// generation and returns nullptr for stale or invalid keys; the unchecked lookup (operator[])
+// is for hot paths where the key is known valid and only asserts the generation in debug builds.
+//
+// Slots are held in a deque so that resources never move in memory when the table grows;
+// pointers to resources thus remain valid until the resource is removed.
+//
+template<typename T>
+class ResourceTable
+{
+public:
+  using Key_t = int32_t;
+
+  static constexpr int INDEX_BITS = 16;
+  static constexpr int GENERATION_BITS = 15;        // top bit unused to keep keys positive.
+  static constexpr Key_t INDEX_MASK = (1 << INDEX_BITS) - 1;
+  static constexpr Key_t GENERATION_MASK = (1 << GENERATION_BITS) - 1;
+  static constexpr int MAX_SLOTS = 1 << INDEX_BITS;
+
+  static constexpr Key_t makeKey(int index, int generation)
+  {
+    return ((generation & GENERATION_MASK) << INDEX_BITS) | (index & INDEX_MASK);
+  }
+
+  static constexpr int keyIndex(Key_t key) {return key & INDEX_MASK;}
+  static constexpr int keyGeneration(Key_t key) {return (key >> INDEX_BITS) & GENERATION_MASK;}
+
+public:
+  //
+  // Moves the resource into a free slot and returns its key.
+  //
+  Key_t insert(T&& resource)
+  {
+    int index;
+    if(!_freeSlots.empty()){
+      index = _freeSlots.back();
+      _freeSlots.pop_back();
+    }
+    else {
+      assert(_slots.size() < MAX_SLOTS);
+      index = _slots.size();
+      _slots.emplace_back();
+    }
+    Slot& slot = _slots[index];
+    slot._resource = std::move(resource);
+    slot._isOccupied = true;
+    return makeKey(index, slot._generation);
+  }
+
+  //
+  // Removes the resource of a valid key. The slot is reset to a default constructed resource
+  // so the memory held by the removed resource is released immediately.
+  //
+  void erase(Key_t key)
+  {
+    assert(isValid(key));
+    int index = keyIndex(key);
+    Slot& slot = _slots[index];
+    slot._resource = T{};
+    slot._isOccupied = false;
+    slot._generation = (slot._generation + 1) & GENERATION_MASK;
+    _freeSlots.push_back(index);
+  }
+
+  bool isValid(Key_t key) const
+  {
+    if(key < 0)
+      return false;
+    int index = keyIndex(key);
+    return index < static_cast<int>(_slots.size()) &&
+           _slots[index]._isOccupied &&
+           _slots[index]._generation == keyGeneration(key);
+  }
+
+  T* find(Key_t key) {return isValid(key) ? &_slots[keyIndex(key)]._resource : nullptr;}
+  const T* find(Key_t key) const {return isValid(key) ? &_slots[keyIndex(key)]._resource : nullptr;}
+
+  T& operator[](Key_t key)
+  {
+    assert(isValid(key));
+    return _slots[keyIndex(key)]._resource;
+  }
+
+  const T& operator[](Key_t key) const
+  {
+    assert(isValid(key));
+    return _slots[keyIndex(key)]._resource;
+  }
+
+  int size() const {return _slots.size() - _freeSlots.size();}
+
+private:
+  struct Slot
+  {
+    T _resource {};
+    int _generation {0};
+    bool _isOccupied {false};
+  };
+
+  std::deque<Slot> _slots;
+  std::vector<int> _freeSlots;
+};
+
+} // namespace pxr
+
+#endif
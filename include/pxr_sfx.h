@@ -153,6 +153,22 @@ extern ResourceKey_t errorSoundKey;
 //
 ResourceKey_t loadSoundWAV(ResourceName_t soundName);
 
+//
+// Asynchronous variant of loadSoundWAV. The sound is decoded on the worker threads (see 
+// pxr_worker.h) and the returned key is usable immediately, playing the error sound until the 
+// load completes, and for good if the load fails. Completed loads are published in onUpdate.
+//
+ResourceKey_t loadSoundWAVAsync(ResourceName_t soundName);
+
+bool isSoundLoading(ResourceKey_t soundKey);
+
+//
+// Returns the number of asynchronous loads in flight, and the fraction [0, 1] of the loads 
+// started since there were last none in flight which have completed (1 if none are in flight).
+//
+int getAsyncLoadCount();
+float getAsyncLoadProgress();
+
 //
 // Adds a sound to the queue of sounds waiting to be unloaded. Sounds in the queue are unloaded
 // once all channels have stopped using it. A call to this function will only actually queue a 
@@ -0,0 +1,45 @@
+#ifndef _PIXIRETRO_WATCH_H_
+#define _PIXIRETRO_WATCH_H_
+
+#include <string>
+#include <vector>
+
+namespace pxr
+{
+namespace watch
+{
+
+//
+// Watches directories for changed files using inotify; used to hot reload assets.
+//
+// A file is reported as changed when it is closed after being written or is moved (renamed)
+// into a watched directory, thus editors which save by writing a temporary file and renaming it
+// over the original are also caught. Directories are not watched recursively.
+//
+// note: the watcher is not thread safe; use from the main thread.
+//
+
+//
+// Returns false if inotify is unavailable, in which case the other functions do nothing.
+//
+bool initialize();
+
+void shutdown();
+
+//
+// Watches a directory w.r.t the app root directory. Returns false if the directory cannot be
+// watched (e.g. does not exist).
+//
+bool addDirectory(const char* path);
+
+//
+// Appends the paths of all files changed since the last poll to changedFiles; never blocks. 
+// Paths are the watched directory path followed by the file name. A file may be reported more 
+// than once if it changed more than once.
+//
+void poll(std::vector<std::string>& changedFiles);
+
+} // namespace watch
+} // namespace pxr
+
+#endif
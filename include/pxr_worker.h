@@ -0,0 +1,66 @@
+#ifndef _PIXIRETRO_WORKER_H_
+#define _PIXIRETRO_WORKER_H_
+
+#include <functional>
+
+namespace pxr
+{
+namespace worker
+{
+
+//
+// A pool of worker threads used to split work across the cores of the machine.
+//
+// The pool runs batches of jobs in a fork-join manner: the calling thread hands a batch of
+// jobs to the pool, works on the batch itself alongside the workers, and then waits for all
+// jobs in the batch to complete before returning. Jobs are claimed one at a time by whichever
+// thread is free so batches should be split into more jobs than there are threads to balance
+// load.
+//
+// The pool also runs background tasks, such as asset loads, which run on whichever worker is
+// free without the calling thread waiting on them. Workers always run batches before tasks.
+//
+// If the pool is not initialized (or has 0 workers) batches and tasks are run on the calling 
+// thread.
+//
+
+//
+// Starts the worker threads. If workerCount=0 the number of workers is chosen automatically
+// to be one less than the number of hardware threads (the calling thread being the other).
+//
+void initialize(int workerCount = 0);
+
+//
+// Stops and joins all worker threads.
+//
+void shutdown();
+
+//
+// Returns the number of worker threads in the pool; excludes the calling thread.
+//
+int getWorkerCount();
+
+//
+// Queues a task to run on a worker thread and returns immediately. Tasks start in submission 
+// order but run concurrently with each other and with the main thread, so must synchronise any 
+// data they share; the usual pattern is for the task to write to data only it has access to and
+// then publish completion through an atomic flag which the main thread polls. Tasks still 
+// queued at shutdown are discarded.
+//
+// note: if the pool has no workers the task is run immediately on the calling thread.
+//
+void submit(std::function<void()> task);
+
+//
+// Runs job(i) for all i in the range [0, jobCount) across the worker threads and the calling
+// thread. Blocks until all jobs have completed. Jobs may run in any order and concurrently so
+// must not write to shared data without synchronisation.
+//
+// note: must only be called from the main thread; calls cannot be nested within jobs.
+//
+void parallelFor(int jobCount, const std::function<void(int)>& job);
+
+} // namespace worker
+} // namespace pxr
+
+#endif
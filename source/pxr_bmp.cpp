@@ -10,6 +10,14 @@
 #include <cstring>
 #include <cassert>
 #include <sstream>
+#include <new>
+#include <algorithm>
+#include <array>
+
+#if defined(__SSSE3__)
+#include <immintrin.h>
+#endif
+
 #include "pxr_color.h"
 #include "pxr_bmp.h"
 #include "pxr_log.h"
@@ -19,9 +27,24 @@ namespace pxr
 namespace io
 {
 
+//
+// Reads a little endian field from a file buffer and advances the offset past it; the caller
+// ensures the buffer holds the field.
+//
+template<typename T>
+static T readField(const std::vector<uint8_t>& file, std::size_t& offset)
+{
+  T value;
+  memcpy(&value, file.data() + offset, sizeof(T));
+  offset += sizeof(T);
+  return value;
+}
+
 Bmp::Bmp() :
   _pixels{nullptr},
-  _size{0,0}
+  _size{0,0},
+  _stride{0},
+  _isView{false}
 {}
 
 Bmp::~Bmp()
@@ -31,14 +54,13 @@ Bmp::~Bmp()
 
 Bmp::Bmp(const Bmp& other) :
   _pixels{nullptr},
-  _size{0, 0}
+  _size{0, 0},
+  _stride{0},
+  _isView{false}
 {
   _size = other._size;
-  _pixels = new gfx::Color4u*[_size._y];
-  for(int row = 0; row < _size._y; ++row){
-    _pixels[row] = new gfx::Color4u[_size._x];
-    memcpy(static_cast<void*>(_pixels[row]), static_cast<void*>(other._pixels[row]), _size._x * sizeof(gfx::Color4u));
-  }
+  reallocatePixels();
+  copyPixels(other);
 }
 
 Bmp::Bmp(Bmp&& other)
@@ -47,24 +69,22 @@ Bmp::Bmp(Bmp&& other)
   other._pixels = nullptr;
   _size = other._size;
   other._size.zero();
+  _stride = other._stride;
+  other._stride = 0;
+  _isView = other._isView;
+  other._isView = false;
 }
 
 Bmp& Bmp::operator=(const Bmp& other)
 {
-  if(_pixels != nullptr && _size == other._size){ 
-    for(int row = 0; row < _size._y; ++row){
-      memcpy(static_cast<void*>(_pixels[row]), static_cast<void*>(other._pixels[row]), _size._x * sizeof(gfx::Color4u));
-    }
+  if(this == &other)
     return *this;
-  }
 
-  freePixels();
-  _size = other._size;
-  _pixels = new gfx::Color4u*[_size._y];
-  for(int row = 0; row < _size._y; ++row){
-    _pixels[row] = new gfx::Color4u[_size._x];
-    memcpy(static_cast<void*>(_pixels[row]), static_cast<void*>(other._pixels[row]), _size._x * sizeof(gfx::Color4u));
+  if(_pixels == nullptr || _isView || _size != other._size){ 
+    _size = other._size;
+    reallocatePixels();
   }
+  copyPixels(other);
   return *this;
 }
 
@@ -75,74 +95,114 @@ Bmp& Bmp::operator=(Bmp&& other)
   other._pixels = nullptr;
   _size = other._size;
   other._size.zero();
+  _stride = other._stride;
+  other._stride = 0;
+  _isView = other._isView;
+  other._isView = false;
   return *this;
 }
 
-const gfx::Color4u Bmp::getPixel(int row, int col)
+gfx::Color4u Bmp::getPixel(int row, int col) const
 {
   assert(0 <= row && row < _size._y);
-  assert(0 <= col && col <= _size._x);
-  return _pixels[row][col];
+  assert(0 <= col && col < _size._x);
+  return _pixels[col + (row * _stride)];
 }
 
-const gfx::Color4u* Bmp::getRow(int row)
+const gfx::Color4u* Bmp::getRow(int row) const
 {
   assert(0 <= row && row < _size._y);
-  return _pixels[row];
+  return _pixels + (row * _stride);
+}
+
+gfx::Color4u* Bmp::getRow(int row)
+{
+  assert(0 <= row && row < _size._y);
+  return _pixels + (row * _stride);
 }
 
 bool Bmp::load(std::string filepath)
 {
-  std::ifstream file {filepath, std::ios_base::binary};
-  if(!file){
+  //
+  // The whole file is read in one go and decoded from memory.
+  //
+  std::ifstream stream {filepath, std::ios_base::binary | std::ios_base::ate};
+  if(!stream){
     log::log(log::ERROR, log::msg_bmp_fail_open, filepath);
     return false;
   }
+  std::vector<uint8_t> file(static_cast<std::size_t>(stream.tellg()));
+  stream.seekg(0);
+  stream.read(reinterpret_cast<char*>(file.data()), file.size());
+  if(!stream){
+    log::log(log::ERROR, log::msg_bmp_fail_open, filepath);
+    return false;
+  }
+
+  if(file.size() < FILEHEADER_SIZE_BYTES + V1INFOHEADER_SIZE_BYTES){
+    log::log(log::ERROR, log::msg_bmp_corrupted, filepath);
+    return false;
+  }
+
+  std::size_t offset {0};
 
   FileHeader fileHead {};
-  file.read(reinterpret_cast<char*>(&fileHead._fileMagic), sizeof(fileHead._fileMagic));
+  fileHead._fileMagic = readField<uint16_t>(file, offset);
 
   if(fileHead._fileMagic != BMPMAGIC){
     log::log(log::ERROR, log::msg_bmp_corrupted, filepath);
     return false;
   }
 
-  file.read(reinterpret_cast<char*>(&fileHead._fileSize_bytes), sizeof(fileHead._fileSize_bytes));
-  file.read(reinterpret_cast<char*>(&fileHead._reserved0), sizeof(fileHead._reserved0));
-  file.read(reinterpret_cast<char*>(&fileHead._reserved1), sizeof(fileHead._reserved1));
-  file.read(reinterpret_cast<char*>(&fileHead._pixelOffset_bytes), sizeof(fileHead._pixelOffset_bytes));
+  fileHead._fileSize_bytes = readField<uint32_t>(file, offset);
+  fileHead._reserved0 = readField<uint16_t>(file, offset);
+  fileHead._reserved1 = readField<uint16_t>(file, offset);
+  fileHead._pixelOffset_bytes = readField<uint32_t>(file, offset);
 
   InfoHeader infoHead {};
-  file.read(reinterpret_cast<char*>(&infoHead._headerSize_bytes), sizeof(infoHead._headerSize_bytes));
-  file.read(reinterpret_cast<char*>(&infoHead._bmpWidth_px), sizeof(infoHead._bmpWidth_px));
-  file.read(reinterpret_cast<char*>(&infoHead._bmpHeight_px), sizeof(infoHead._bmpHeight_px));
-  file.read(reinterpret_cast<char*>(&infoHead._numColorPlanes), sizeof(infoHead._numColorPlanes));
-  file.read(reinterpret_cast<char*>(&infoHead._bitsPerPixel), sizeof(infoHead._bitsPerPixel));
-  file.read(reinterpret_cast<char*>(&infoHead._compression), sizeof(infoHead._compression));
-  file.read(reinterpret_cast<char*>(&infoHead._imageSize_bytes), sizeof(infoHead._imageSize_bytes));
-  file.read(reinterpret_cast<char*>(&infoHead._xResolution_pxPm), sizeof(infoHead._xResolution_pxPm));
-  file.read(reinterpret_cast<char*>(&infoHead._yResolution_pxPm), sizeof(infoHead._yResolution_pxPm));
-  file.read(reinterpret_cast<char*>(&infoHead._numPaletteColors), sizeof(infoHead._numPaletteColors));
-  file.read(reinterpret_cast<char*>(&infoHead._numImportantColors), sizeof(infoHead._numImportantColors));
+  infoHead._headerSize_bytes = readField<uint32_t>(file, offset);
+  infoHead._bmpWidth_px = readField<int32_t>(file, offset);
+  infoHead._bmpHeight_px = readField<int32_t>(file, offset);
+  infoHead._numColorPlanes = readField<uint16_t>(file, offset);
+  infoHead._bitsPerPixel = readField<uint16_t>(file, offset);
+  infoHead._compression = readField<uint32_t>(file, offset);
+  infoHead._imageSize_bytes = readField<uint32_t>(file, offset);
+  infoHead._xResolution_pxPm = readField<int32_t>(file, offset);
+  infoHead._yResolution_pxPm = readField<int32_t>(file, offset);
+  infoHead._numPaletteColors = readField<uint32_t>(file, offset);
+  infoHead._numImportantColors = readField<uint32_t>(file, offset);
+
+  //
+  // The masks follow the v1 header (either as part of the v2+ headers or as a separate table 
+  // of 3 masks for v1 headers with bitfields compression).
+  //
+  std::size_t headerSize_bytes = std::max<std::size_t>(infoHead._headerSize_bytes, 
+                                                       V1INFOHEADER_SIZE_BYTES);
+  if(infoHead._headerSize_bytes == V1INFOHEADER_SIZE_BYTES && infoHead._compression == BI_BITFIELDS)
+    headerSize_bytes += 3 * sizeof(uint32_t);
+  if(file.size() < FILEHEADER_SIZE_BYTES + headerSize_bytes){
+    log::log(log::ERROR, log::msg_bmp_corrupted, filepath);
+    return false;
+  }
 
   int infoHeadVersion {1};
 
   if(infoHead._headerSize_bytes >= V2INFOHEADER_SIZE_BYTES ||
     (infoHead._headerSize_bytes == V1INFOHEADER_SIZE_BYTES && infoHead._compression == BI_BITFIELDS))
   {
-    file.read(reinterpret_cast<char*>(&infoHead._redMask), sizeof(infoHead._redMask));
-    file.read(reinterpret_cast<char*>(&infoHead._greenMask), sizeof(infoHead._greenMask));
-    file.read(reinterpret_cast<char*>(&infoHead._blueMask), sizeof(infoHead._blueMask));
+    infoHead._redMask = readField<uint32_t>(file, offset);
+    infoHead._greenMask = readField<uint32_t>(file, offset);
+    infoHead._blueMask = readField<uint32_t>(file, offset);
     infoHeadVersion = 2;
   }
 
   if(infoHead._headerSize_bytes >= V3INFOHEADER_SIZE_BYTES){
-    file.read(reinterpret_cast<char*>(&infoHead._alphaMask), sizeof(infoHead._alphaMask));
+    infoHead._alphaMask = readField<uint32_t>(file, offset);
     infoHeadVersion = 3;
   }
 
   if(infoHead._headerSize_bytes >= V4INFOHEADER_SIZE_BYTES){
-    file.read(reinterpret_cast<char*>(&infoHead._colorSpaceMagic), sizeof(infoHead._colorSpaceMagic));
+    infoHead._colorSpaceMagic = readField<uint32_t>(file, offset);
     if(infoHead._colorSpaceMagic != SRGBMAGIC){
       log::log(log::ERROR, log::msg_bmp_unsupported_colorspace, std::string{});
       return false;
@@ -164,12 +224,28 @@ bool Bmp::load(std::string filepath)
     std::stringstream ss{};
     ss << "[w:" << _size._x << ",h:" << _size._y << "]";
     log::log(log::ERROR, log::msg_bmp_unsupported_size, ss.str());
+    _size.zero();
+    return false;
+  }
+
+  int bpp = infoHead._bitsPerPixel;
+  if(bpp != 1 && bpp != 2 && bpp != 4 && bpp != 8 && bpp != 16 && bpp != 24 && bpp != 32){
+    log::log(log::ERROR, log::msg_bmp_corrupted, filepath);
+    _size.zero();
+    return false;
+  }
+
+  std::size_t rowSize_bytes = calculateRowSize(bpp, _size._x);
+  if(fileHead._pixelOffset_bytes > file.size() || 
+     rowSize_bytes * _size._y > file.size() - fileHead._pixelOffset_bytes){
+    log::log(log::ERROR, log::msg_bmp_corrupted, filepath);
+    _size.zero();
     return false;
   }
 
   reallocatePixels();
 
-  switch(infoHead._bitsPerPixel)
+  switch(bpp)
   {
   case 1:
   case 2:
@@ -209,6 +285,73 @@ bool Bmp::load(std::string filepath)
   return true;
 }
 
+//
+// Appends a little endian field to a file buffer.
+//
+template<typename T>
+static void writeField(std::vector<uint8_t>& file, T value)
+{
+  std::size_t offset = file.size();
+  file.resize(offset + sizeof(T));
+  memcpy(file.data() + offset, &value, sizeof(T));
+}
+
+bool Bmp::save(const std::string& filepath) const
+{
+  uint32_t imageSize = static_cast<uint32_t>(_size._x) * _size._y * sizeof(uint32_t);
+  uint32_t pixelOffset = FILEHEADER_SIZE_BYTES + V4INFOHEADER_SIZE_BYTES;
+
+  std::vector<uint8_t> file {};
+  file.reserve(pixelOffset + imageSize);
+
+  writeField<uint16_t>(file, BMPMAGIC);
+  writeField<uint32_t>(file, pixelOffset + imageSize);
+  writeField<uint16_t>(file, 0);
+  writeField<uint16_t>(file, 0);
+  writeField<uint32_t>(file, pixelOffset);
+
+  writeField<uint32_t>(file, V4INFOHEADER_SIZE_BYTES);
+  writeField<int32_t>(file, _size._x);
+  writeField<int32_t>(file, _size._y);    // positive height; rows ordered bottom to top.
+  writeField<uint16_t>(file, 1);
+  writeField<uint16_t>(file, 32);
+  writeField<uint32_t>(file, BI_BITFIELDS);
+  writeField<uint32_t>(file, imageSize);
+  writeField<int32_t>(file, 2835);        // 72 dpi.
+  writeField<int32_t>(file, 2835);
+  writeField<uint32_t>(file, 0);
+  writeField<uint32_t>(file, 0);
+  writeField<uint32_t>(file, 0x00ff0000);
+  writeField<uint32_t>(file, 0x0000ff00);
+  writeField<uint32_t>(file, 0x000000ff);
+  writeField<uint32_t>(file, 0xff000000);
+  writeField<uint32_t>(file, SRGBMAGIC);
+  file.resize(pixelOffset, 0);            // unused v4 color space endpoints and gammas.
+
+  //
+  // 32 bit rows need no padding; pixels are stored as little endian 0xAARRGGBB.
+  //
+  file.resize(pixelOffset + imageSize);
+  uint8_t* dst = file.data() + pixelOffset;
+  for(int row = 0; row < _size._y; ++row){
+    const gfx::Color4u* pixels = getRow(row);
+    for(int col = 0; col < _size._x; ++col, dst += 4){
+      dst[0] = pixels[col]._b;
+      dst[1] = pixels[col]._g;
+      dst[2] = pixels[col]._r;
+      dst[3] = pixels[col]._a;
+    }
+  }
+
+  std::ofstream stream {filepath, std::ios_base::binary | std::ios_base::trunc};
+  stream.write(reinterpret_cast<const char*>(file.data()), file.size());
+  if(!stream){
+    log::log(log::ERROR, log::msg_bmp_fail_write, filepath);
+    return false;
+  }
+  return true;
+}
+
 void Bmp::create(Vector2i size, gfx::Color4u clearColor)
 {
   _size = size;
@@ -222,111 +365,207 @@ void Bmp::clear(gfx::Color4u color)
     return;
 
   for(int row = 0; row < _size._y; ++row)
-    for(int col = 0; col < _size._x; ++col)
-      _pixels[row][col] = color;
+    std::fill_n(getRow(row), _size._x, color);
+}
+
+void Bmp::view(gfx::Color4u* pixels, Vector2i size, int stride)
+{
+  assert(stride == calculateStride(size._x));
+  assert(reinterpret_cast<uintptr_t>(pixels) % PIXEL_ALIGNMENT == 0);
+  freePixels();
+  _pixels = pixels;
+  _size = size;
+  _stride = stride;
+  _isView = true;
 }
 
 void Bmp::freePixels()
 {
-  if(_pixels != nullptr){
-    for(int row = 0; row < _size._y; ++row)
-      delete[] _pixels[row];
-    delete[] _pixels;
-  }
+  if(_pixels != nullptr && !_isView)
+    ::operator delete[](_pixels, std::align_val_t{PIXEL_ALIGNMENT});
   _pixels = nullptr;
+  _isView = false;
+}
+
+int Bmp::calculateStride(int width)
+{
+  static constexpr int pixelsPerAlignment = PIXEL_ALIGNMENT / sizeof(gfx::Color4u);
+  return ((width + pixelsPerAlignment - 1) / pixelsPerAlignment) * pixelsPerAlignment;
 }
 
 void Bmp::reallocatePixels()
 {
   freePixels();
-  _pixels = new gfx::Color4u*[_size._y];
-  for(int row = 0; row < _size._y; ++row)
-    _pixels[row] = new gfx::Color4u[_size._x];
+
+  _stride = calculateStride(_size._x);
+
+  std::size_t bytes = static_cast<std::size_t>(_stride) * _size._y * sizeof(gfx::Color4u);
+  if(bytes == 0)
+    return;
+
+  _pixels = static_cast<gfx::Color4u*>(::operator new[](bytes, std::align_val_t{PIXEL_ALIGNMENT}));
 }
 
-void Bmp::extractIndexedPixels(std::ifstream& file, FileHeader& fileHead, InfoHeader& infoHead)
+//
+// Copies the pixels of an image of the same size; both images have the same stride as stride
+// is a function of width.
+//
+void Bmp::copyPixels(const Bmp& other)
 {
-  // extract the color palette.
-  std::vector<gfx::Color4u> palette {};
-  file.seekg(FILEHEADER_SIZE_BYTES + infoHead._headerSize_bytes, std::ios::beg);
-  for(uint8_t i = 0; i < infoHead._numPaletteColors; ++i){
-    char bytes[4];
-    file.read(bytes, 4);
+  assert(_size == other._size && _stride == other._stride);
+  if(_pixels == nullptr || other._pixels == nullptr)
+    return;
 
-    // colors expected in the byte order blue (0), green (1), red (2), alpha (3).
-    uint8_t red = static_cast<uint8_t>(bytes[2]);
-    uint8_t green = static_cast<uint8_t>(bytes[1]);
-    uint8_t blue = static_cast<uint8_t>(bytes[0]);
-    uint8_t alpha = static_cast<uint8_t>(bytes[3]);
+  memcpy(static_cast<void*>(_pixels), static_cast<const void*>(other._pixels), 
+         static_cast<std::size_t>(_stride) * _size._y * sizeof(gfx::Color4u));
+}
+
+std::size_t Bmp::calculateRowSize(int bitsPerPixel, int width)
+{
+  // rows are padded to a multiple of 4 bytes.
+  return ((static_cast<std::size_t>(bitsPerPixel) * width + 31) / 32) * 4;
+}
+
+//
+// Returns the file offset of the row of pixels which is row 'row' in memory. Files store rows 
+// either bottom to top (positive height) or top to bottom (negative height) whereas in memory
+// rows are always bottom to top.
+//
+static std::size_t calculateRowOffset(std::size_t pixelOffset, std::size_t rowSize, int row, int numRows, bool isTopOrigin)
+{
+  int fileRow = isTopOrigin ? (numRows - 1 - row) : row;
+  return pixelOffset + (static_cast<std::size_t>(fileRow) * rowSize);
+}
+
+//
+// Decodes a row of 8-bit indexed pixels; the palette has 256 entries so any index is valid.
+//
+static void decodeRow8(const uint8_t* src, gfx::Color4u* dst, int width, const gfx::Color4u* palette)
+{
+  for(int col = 0; col < width; ++col)
+    dst[col] = palette[src[col]];
+}
 
-    palette.push_back(gfx::Color4u{red, green, blue, alpha});
+//
+// Decodes a row of 32-bit pixels stored as bytes (b, g, r, a), i.e. the default masks, into
+// (r, g, b, a). If the alpha mask of the file is 0 alpha is instead set to 0.
+//
+static void decodeRowBGRA(const uint8_t* src, gfx::Color4u* dst, int width, bool hasAlpha)
+{
+  int col {0};
+#if defined(__SSSE3__)
+  const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+  const __m128i keep = _mm_set1_epi32(hasAlpha ? -1 : 0x00ffffff);
+  for(; col + 4 <= width; col += 4){
+    __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + (col * 4)));
+    px = _mm_and_si128(_mm_shuffle_epi8(px, shuffle), keep);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + col), px);
+  }
+#endif
+  for(; col < width; ++col){
+    const uint8_t* p = src + (col * 4);
+    dst[col] = gfx::Color4u{p[2], p[1], p[0], hasAlpha ? p[3] : uint8_t{0}};
   }
+}
 
-  int rowSize_bytes = std::ceil((infoHead._bitsPerPixel * infoHead._bmpWidth_px) / 32.f) * 4.f;  
-  int numPixelsPerByte = 8 / infoHead._bitsPerPixel;
+//
+// Decodes a row of 24-bit pixels stored as bytes (b, g, r) into (r, g, b, 0); alpha is 0 as
+// 24-bit images have no alpha channel (the alpha mask is 0).
+//
+static void decodeRowBGR(const uint8_t* src, gfx::Color4u* dst, int width)
+{
+  int col {0};
+#if defined(__SSSE3__)
+  //
+  // Each iteration loads 16 bytes but only uses the first 12 (4 pixels); stopping 2 pixels 
+  // early keeps the loads within the row.
+  //
+  const __m128i shuffle = _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+  for(; col + 6 <= width; col += 4){
+    __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + (col * 3)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + col), _mm_shuffle_epi8(px, shuffle));
+  }
+#endif
+  for(; col < width; ++col){
+    const uint8_t* p = src + (col * 3);
+    dst[col] = gfx::Color4u{p[2], p[1], p[0], 0};
+  }
+}
 
-  uint8_t mask {0};
-  for(int i = 0; i < infoHead._bitsPerPixel; ++i)
-    mask |= (0x01 << i);
+void Bmp::extractIndexedPixels(const std::vector<uint8_t>& file, FileHeader& fileHead, InfoHeader& infoHead)
+{
+  //
+  // The palette follows the info header; a palette size of 0 implies the max size. The palette
+  // is padded to 256 entries so corrupt indices cannot read out of bounds.
+  //
+  int bpp = infoHead._bitsPerPixel;
+  std::size_t numPaletteColors = infoHead._numPaletteColors;
+  if(numPaletteColors == 0 || numPaletteColors > (1u << bpp))
+    numPaletteColors = 1u << bpp;
+
+  std::size_t paletteOffset = FILEHEADER_SIZE_BYTES + infoHead._headerSize_bytes;
+  if(paletteOffset > file.size())
+    numPaletteColors = 0;
+  else
+    numPaletteColors = std::min(numPaletteColors, (file.size() - paletteOffset) / 4);
+
+  std::array<gfx::Color4u, 256> palette {};
+  for(std::size_t i = 0; i < numPaletteColors; ++i){
+    // colors expected in the byte order blue (0), green (1), red (2), alpha (3).
+    const uint8_t* bytes = file.data() + paletteOffset + (i * 4);
+    palette[i] = gfx::Color4u{bytes[2], bytes[1], bytes[0], bytes[3]};
+  }
 
-  int numRows = std::abs(infoHead._bmpHeight_px);
+  std::size_t rowSize_bytes = calculateRowSize(bpp, _size._x);
   bool isTopOrigin = (infoHead._bmpHeight_px < 0);
-  int pixelOffset_bytes = static_cast<int>(fileHead._pixelOffset_bytes);
-  int rowOffset_bytes {rowSize_bytes};
-  if(isTopOrigin){
-    pixelOffset_bytes += (numRows - 1) * rowSize_bytes;
-    rowOffset_bytes *= -1;
-  }
+  int numPixelsPerByte = 8 / bpp;
+  uint8_t mask = static_cast<uint8_t>((1u << bpp) - 1);
+
+  for(int row = 0; row < _size._y; ++row){
+    std::size_t rowOffset = calculateRowOffset(fileHead._pixelOffset_bytes, rowSize_bytes, row, _size._y, isTopOrigin);
+    const uint8_t* src = file.data() + rowOffset;
+    gfx::Color4u* rowPixels = getRow(row);
 
-  int seekPos {pixelOffset_bytes};
-  char* buffer = new char[rowSize_bytes];
-
-  // for each row of pixels.
-  for(int row = 0; row < numRows; ++row){
-    file.seekg(seekPos);
-    file.read(static_cast<char*>(buffer), rowSize_bytes);
-
-    // for each pixel in the row.
-    int col {0};
-    int byteNo {0};
-    int bytePixelNo {0};
-    uint8_t byte = static_cast<uint8_t>(buffer[byteNo]);
-    while(col < infoHead._bmpWidth_px){
-      if(bytePixelNo >= numPixelsPerByte){
-        byte = static_cast<uint8_t>(buffer[++byteNo]);
-        bytePixelNo = 0;
-      }
-      int shift = infoHead._bitsPerPixel * (numPixelsPerByte - 1 - bytePixelNo);
-      uint8_t index = (byte & (mask << shift)) >> shift;
-      _pixels[row][col] = palette[index];
-      ++col;
-      ++bytePixelNo;
+    if(bpp == 8){
+      decodeRow8(src, rowPixels, _size._x, palette.data());
+      continue;
+    }
+
+    // pixels are packed from the most significant bits of each byte.
+    for(int col = 0; col < _size._x; ++col){
+      int shift = bpp * (numPixelsPerByte - 1 - (col % numPixelsPerByte));
+      uint8_t index = (src[col / numPixelsPerByte] >> shift) & mask;
+      rowPixels[col] = palette[index];
     }
-    seekPos += rowOffset_bytes;
   }
-  delete[] buffer;
 }
 
-void Bmp::extractPixels(std::ifstream& file, FileHeader& fileHead, InfoHeader& infoHead)
+void Bmp::extractPixels(const std::vector<uint8_t>& file, FileHeader& fileHead, InfoHeader& infoHead)
 {
   // note: this function handles 16-bit, 24-bit and 32-bit pixels.
 
-  // If bitmap height is negative the origin is in top-left corner in the file so the first
-  // row in the file is the top row of the image. This class always places the origin in the
-  // bottom left so in this case we want to read the last row in the file first to reorder the 
-  // in-memory pixels. If the bitmap height is positive then we can simply read the first row
-  // in the file first, as this will be the first row in the in-memory bitmap.
-  
-  int rowSize_bytes = std::ceil((infoHead._bitsPerPixel * infoHead._bmpWidth_px) / 32.f) * 4.f;  
+  std::size_t rowSize_bytes = calculateRowSize(infoHead._bitsPerPixel, _size._x);
   int pixelSize_bytes = infoHead._bitsPerPixel / 8;
-
-  int numRows = std::abs(infoHead._bmpHeight_px);
   bool isTopOrigin = (infoHead._bmpHeight_px < 0);
-  int pixelOffset_bytes = static_cast<int>(fileHead._pixelOffset_bytes);
-  int rowOffset_bytes {rowSize_bytes};
-  if(isTopOrigin){
-    pixelOffset_bytes += (numRows - 1) * rowSize_bytes;
-    rowOffset_bytes *= -1;
+
+  //
+  // Fast paths for the common byte aligned formats using the default masks.
+  //
+  bool isBGR = infoHead._redMask == 0xff0000 && infoHead._greenMask == 0x00ff00 && 
+               infoHead._blueMask == 0x0000ff;
+  bool isBGRA32 = isBGR && infoHead._bitsPerPixel == 32 && 
+                  (infoHead._alphaMask == 0xff000000 || infoHead._alphaMask == 0);
+  bool isBGR24 = isBGR && infoHead._bitsPerPixel == 24 && infoHead._alphaMask == 0;
+
+  if(isBGRA32 || isBGR24){
+    for(int row = 0; row < _size._y; ++row){
+      std::size_t rowOffset = calculateRowOffset(fileHead._pixelOffset_bytes, rowSize_bytes, row, _size._y, isTopOrigin);
+      if(isBGRA32)
+        decodeRowBGRA(file.data() + rowOffset, getRow(row), _size._x, infoHead._alphaMask != 0);
+      else
+        decodeRowBGR(file.data() + rowOffset, getRow(row), _size._x);
+    }
+    return;
   }
 
   // shift values are needed when using channel masks to extract color channel data from
@@ -336,51 +575,35 @@ void Bmp::extractPixels(std::ifstream& file, FileHeader& fileHead, InfoHeader& i
   int blueShift {0};
   int alphaShift {0};
 
-  while((infoHead._redMask & (0x01 << redShift)) == 0) ++redShift;
-  while((infoHead._greenMask & (0x01 << greenShift)) == 0) ++greenShift;
-  while((infoHead._blueMask & (0x01 << blueShift)) == 0) ++blueShift;
+  if(infoHead._redMask)
+    while((infoHead._redMask & (0x01 << redShift)) == 0) ++redShift;
+  if(infoHead._greenMask)
+    while((infoHead._greenMask & (0x01 << greenShift)) == 0) ++greenShift;
+  if(infoHead._blueMask)
+    while((infoHead._blueMask & (0x01 << blueShift)) == 0) ++blueShift;
   if(infoHead._alphaMask)
     while((infoHead._alphaMask & (0x01 << alphaShift)) == 0) ++alphaShift;
 
-  int seekPos {pixelOffset_bytes};
-  char* buffer = new char[rowSize_bytes];
-
-  // for each row of pixels.
-  for(int row = 0; row < numRows; ++row){
-    file.seekg(seekPos);
-    file.read(static_cast<char*>(buffer), rowSize_bytes);
+  for(int row = 0; row < _size._y; ++row){
+    std::size_t rowOffset = calculateRowOffset(fileHead._pixelOffset_bytes, rowSize_bytes, row, _size._y, isTopOrigin);
+    const uint8_t* src = file.data() + rowOffset;
+    gfx::Color4u* rowPixels = getRow(row);
 
-    // for each pixel in row.
-    for(int col = 0; col < infoHead._bmpWidth_px; ++col){
+    for(int col = 0; col < _size._x; ++col){
       uint32_t rawPixelBytes {0};
 
-      // for each pixel byte.
-      for(int i = 0; i < pixelSize_bytes; ++i){
-        uint8_t pixelByte = buffer[(col * pixelSize_bytes) + i];
-
-        // 0rth byte of pixel stored in LSB of rawPixelBytes.
-        rawPixelBytes |= static_cast<uint32_t>(pixelByte << (i * 8));
-      }
+      // 0rth byte of pixel stored in LSB of rawPixelBytes.
+      for(int i = 0; i < pixelSize_bytes; ++i)
+        rawPixelBytes |= static_cast<uint32_t>(src[(col * pixelSize_bytes) + i]) << (i * 8);
 
       uint8_t red = (rawPixelBytes & infoHead._redMask) >> redShift;
       uint8_t green = (rawPixelBytes & infoHead._greenMask) >> greenShift;
       uint8_t blue = (rawPixelBytes & infoHead._blueMask) >> blueShift;
       uint8_t alpha = (rawPixelBytes & infoHead._alphaMask) >> alphaShift;
 
-      //
-      // Bug fix: In my gfx module all pixels with alpha==0 are not drawn. When loading 24-bit
-      // bmp images that have no alpha channel, was previously setting the alpha channel of all
-      // pixels to a default of 0 thus the image was not being draw. The fix is thus to set the
-      // default to 255.
-      //
-      //uint8_t alpha = infoHead._alphaMask == 0 ? 
-      //  (rawPixelBytes & infoHead._alphaMask) >> alphaShift : 255;
-
-      _pixels[row][col] = gfx::Color4u{red, green, blue, alpha};
+      rowPixels[col] = gfx::Color4u{red, green, blue, alpha};
     }
-    seekPos += rowOffset_bytes;
   }
-  delete[] buffer;
 }
 
 } // namespace io
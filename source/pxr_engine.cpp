@@ -3,6 +3,13 @@
 #include <sstream>
 #include <iomanip>
 #include <cassert>
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <filesystem>
 #include "pxr_engine.h"
 #include "pxr_log.h"
 #include "pxr_game.h"
@@ -11,6 +18,10 @@
 #include "pxr_sfx.h"
 #include "pxr_color.h"
 #include "pxr_rand.h"
+#include "pxr_worker.h"
+#include "pxr_pak.h"
+#include "pxr_watch.h"
+#include "pxr_prof.h"
 
 #include <iostream>
 
@@ -20,6 +31,10 @@ namespace pxr
 
 Engine::Duration_t Engine::RealClock::update()
 {
+  if(_simulatedStep != Duration_t::zero()){
+    _now += _simulatedStep;
+    return _simulatedStep;
+  }
   auto old = _now;
   _now = Clock_t::now();
   return _now - old;
@@ -87,6 +102,24 @@ void Engine::Ticker::doTicks(Duration_t gameNow, Duration_t realNow)
   }
 }
 
+//
+// Returns the fraction of the next tick's period elapsed at the given time on the ticker's 
+// timeline, or 1 if ticks are held back by the ticks per frame limit.
+//
+float Engine::Ticker::getTickAlpha(Duration_t now) const
+{
+  if(_ticksAccumulated > 0)
+    return 1.f;
+  float alpha = static_cast<double>((now - _tickerNow).count()) / _tickPeriod.count();
+  return std::clamp(alpha, 0.f, 1.f);
+}
+
+void Engine::Ticker::setTickPeriod(Duration_t tickPeriod)
+{
+  _tickPeriod = tickPeriod;
+  _tickPeriodSeconds = static_cast<float>(tickPeriod.count()) / oneSecond.count();
+}
+
 void Engine::Ticker::reset()
 {
   _tickerNow = Duration_t::zero();
@@ -97,15 +130,171 @@ void Engine::Ticker::reset()
   _ticksAccumulated = 0;
 }
 
+void Engine::FramePacer::waitUntil(TimePoint_t deadline)
+{
+  TimePoint_t now = Clock_t::now();
+  while((deadline - now) > getExpectedSleep()){
+    std::this_thread::sleep_for(SLEEP_QUANTUM);
+    TimePoint_t woke = Clock_t::now();
+
+    //
+    // Exponentially weighted moving mean and variance of the sleep times.
+    //
+    double sample = std::min(woke - now, MAX_SLEEP_SAMPLE).count();
+    double difference = sample - _sleepMean;
+    double increment = SLEEP_SAMPLE_WEIGHT * difference;
+    _sleepMean += increment;
+    _sleepVariance = (1.0 - SLEEP_SAMPLE_WEIGHT) * (_sleepVariance + (difference * increment));
+
+    now = woke;
+  }
+
+  while(Clock_t::now() < deadline)
+    std::this_thread::yield();
+}
+
+//
+// Starts from the pessimistic guess that sleeps take two quanta.
+//
+void Engine::FramePacer::reset()
+{
+  _sleepMean = SLEEP_QUANTUM.count();
+  _sleepVariance = static_cast<double>(SLEEP_QUANTUM.count()) * SLEEP_QUANTUM.count();
+}
+
+Engine::Duration_t Engine::FramePacer::getExpectedSleep() const
+{
+  return Duration_t{static_cast<int64_t>(_sleepMean + std::sqrt(_sleepVariance))};
+}
+
+int Engine::DurationHistogram::durationToBucket(int64_t us)
+{
+  if(us < SUB_BUCKET_COUNT)
+    return us;
+
+  int exponent {SUB_BUCKET_BITS};
+  while((us >> (exponent + 1)) != 0)
+    ++exponent;
+
+  int shift = exponent - SUB_BUCKET_BITS;
+  int subBucket = (us >> shift) - SUB_BUCKET_COUNT;
+  return ((shift + 1) * SUB_BUCKET_COUNT) + subBucket;
+}
+
+//
+// Returns the longest duration in the bucket, so percentiles err on the side of slow.
+//
+int64_t Engine::DurationHistogram::bucketToDuration(int bucket)
+{
+  if(bucket < SUB_BUCKET_COUNT)
+    return bucket;
+
+  int shift = (bucket / SUB_BUCKET_COUNT) - 1;
+  int subBucket = bucket % SUB_BUCKET_COUNT;
+  int64_t lowest = static_cast<int64_t>(SUB_BUCKET_COUNT + subBucket) << shift;
+  return lowest + (int64_t{1} << shift) - 1;
+}
+
+void Engine::DurationHistogram::record(Duration_t duration)
+{
+  int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+  us = std::clamp(us, int64_t{0}, MAX_DURATION_US);
+  ++_buckets[durationToBucket(us)];
+  ++_count;
+  _max = std::max(_max, duration);
+}
+
+void Engine::DurationHistogram::add(const DurationHistogram& other)
+{
+  for(int i = 0; i < BUCKET_COUNT; ++i)
+    _buckets[i] += other._buckets[i];
+  _count += other._count;
+  _max = std::max(_max, other._max);
+}
+
+void Engine::DurationHistogram::reset()
+{
+  _buckets.fill(0);
+  _count = 0;
+  _max = Duration_t::zero();
+}
+
+Engine::Duration_t Engine::DurationHistogram::getPercentile(double percentile) const
+{
+  if(_count == 0)
+    return Duration_t::zero();
+
+  int64_t rank = std::ceil((percentile / 100.0) * _count);
+  rank = std::clamp(rank, int64_t{1}, _count);
+  int64_t counted {0};
+  for(int i = 0; i < BUCKET_COUNT; ++i){
+    counted += _buckets[i];
+    if(counted >= rank){
+      Duration_t duration = std::chrono::microseconds{bucketToDuration(i)};
+      return std::min(duration, _max);
+    }
+  }
+  return _max;
+}
+
+void Engine::FrameTimes::add(const FrameTimes& other)
+{
+  _frame.add(other._frame);
+  _update.add(other._update);
+  _draw.add(other._draw);
+}
+
+void Engine::FrameTimes::reset()
+{
+  _frame.reset();
+  _update.reset();
+  _draw.reset();
+}
+
+std::string Engine::DurationHistogram::toString() const
+{
+  std::stringstream ss {};
+  ss << std::fixed << std::setprecision(2);
+  ss << "p50=" << durationToMilliseconds(getPercentile(50.0))
+     << " p95=" << durationToMilliseconds(getPercentile(95.0))
+     << " p99=" << durationToMilliseconds(getPercentile(99.0))
+     << " max=" << durationToMilliseconds(getMax())
+     << " n=" << getCount();
+  return ss.str();
+}
+
+std::string Engine::FrameTimes::toString() const
+{
+  return "frame [ms] " + _frame.toString() + 
+         " -- update [ms] " + _update.toString() + 
+         " -- draw [ms] " + _draw.toString();
+}
+
 void Engine::initialize(std::unique_ptr<Game> game)
 {
   log::initialize();
   input::initialize();
+  prof::setThreadName("main");
 
   if(_rc.load(EngineRC::filename) < 0)
     _rc.write(EngineRC::filename);    // generate a default rc file if one doesn't exist.
 
-  if(SDL_Init(SDL_INIT_VIDEO) < 0){
+  worker::initialize(_rc.getIntValue(EngineRC::KEY_WORKER_THREADS));
+
+  pak::open(pak::ARCHIVE_PATH);   // optional; assets are loaded from files if there is none.
+
+  _isHeadless = _rc.getBoolValue(EngineRC::KEY_HEADLESS);
+  if(const char* env = std::getenv(headlessEnvVar))
+    _isHeadless = (env[0] != '\0' && strcmp(env, "0") != 0);
+
+  //
+  // Headless runs need no video, and play sound to the dummy audio driver so they run on 
+  // machines without a sound device; the SDL_AUDIODRIVER environment variable still overrides.
+  //
+  if(_isHeadless)
+    SDL_SetHint(SDL_HINT_AUDIODRIVER, "dummy");
+
+  if(SDL_Init(_isHeadless ? SDL_INIT_EVENTS : SDL_INIT_VIDEO) < 0){
     log::log(log::FATAL, log::msg_eng_fail_sdl_init, std::string{SDL_GetError()});
     exit(EXIT_FAILURE);
   }
@@ -124,10 +313,13 @@ void Engine::initialize(std::unique_ptr<Game> game)
   // std::seed_seq seq{1, 2, 3, 4, 5};
   // randGenerator.seed(seq);
   //
+  // Headless runs use a fixed seed so they are deterministic.
+  //
   std::random_device rd{};
   rand::xorwow::state_type seedstate {};
+  uint32_t fixedSeed {1};
   for(auto& seed : seedstate)
-    seed = rd();
+    seed = _isHeadless ? fixedSeed++ : rd();
   rand::generator.seed(seedstate);
 
   _game = std::move(game);
@@ -143,7 +335,9 @@ void Engine::initialize(std::unique_ptr<Game> game)
   windowSize._x = _rc.getIntValue(EngineRC::KEY_WINDOW_WIDTH);
   windowSize._y = _rc.getIntValue(EngineRC::KEY_WINDOW_HEIGHT);
   bool fullscreen = _rc.getBoolValue(EngineRC::KEY_FULLSCREEN);
-  if(!gfx::initialize(ss.str(), windowSize, fullscreen)){
+  bool isGfxInitialized = _isHeadless ? gfx::initializeHeadless(windowSize) :
+                                        gfx::initialize(ss.str(), windowSize, fullscreen);
+  if(!isGfxInitialized){
     log::log(log::FATAL, log::msg_gfx_fail_init);
     exit(EXIT_FAILURE);
   }
@@ -171,7 +365,9 @@ void Engine::initialize(std::unique_ptr<Game> game)
 
   //_splashSoundKey = sfx::loadSound(splashName);
   _splashSpriteKey = gfx::loadSpritesheet(splashName);
-  if(gfx::isErrorSpritesheet(_splashSpriteKey)){
+  if(_isHeadless)
+    onSplashExit();
+  else if(gfx::isErrorSpritesheet(_splashSpriteKey)){
     log::log(log::INFO, log::msg_eng_fail_load_splash);
     onSplashExit();
   }
@@ -187,28 +383,53 @@ void Engine::initialize(std::unique_ptr<Game> game)
     gfx::setScreenSizeMode(gfx::SizeMode::AUTO_MAX, _pauseScreenId);
   }
 
-  gfx::Color4u clearColor {
-    static_cast<uint8_t>(_rc.getIntValue(EngineRC::KEY_CLEAR_RED)),
-    static_cast<uint8_t>(_rc.getIntValue(EngineRC::KEY_CLEAR_GREEN)),
-    static_cast<uint8_t>(_rc.getIntValue(EngineRC::KEY_CLEAR_BLUE)),
-    255
-  };
-
-  _clearColor = clearColor;
+  applyRC();
+
+  _isHotReloading = false;
+  if(_rc.getBoolValue(EngineRC::KEY_HOT_RELOAD)){
+    _isHotReloading = watch::initialize() &&
+                      watch::addDirectory(gfx::RESOURCE_PATH_SPRITESHEETS) &&
+                      watch::addDirectory(gfx::RESOURCE_PATH_FONTS) &&
+                      watch::addDirectory(io::RESOURCE_PATH_RC);
+    if(_isHotReloading)
+      log::log(log::INFO, log::msg_eng_hot_reload);
+    else{
+      log::log(log::ERROR, log::msg_eng_fail_hot_reload);
+      watch::shutdown();
+    }
+  }
 
   _framesDone = 0;
   _framesDoneThisSecond = 0;
   _measuredFrameFrequency = 0;
   _lastFrameMeasureNow = Duration_t::zero();
+  _statsWindowTimes.reset();
+  _lastStatsWindowTimes.reset();
+  _logPeriodTimes.reset();
+  _statsWindowStart = Duration_t::zero();
+  _logPeriodStart = Duration_t::zero();
+  _lastDrawStart = TimePoint_t{};
+  _frameTimeGraph.fill(Duration_t::zero());
+  _frameTimeGraphHead = 0;
+
   _isDrawingEngineStats = false;
   _isDone = false;
+
+  _headlessFramesDrawn = 0;
+  if(_isHeadless){
+    log::log(log::INFO, log::msg_eng_headless);
+    _headlessWallStart = Clock_t::now();
+  }
 }
 
 void Engine::shutdown()
 {
   _game->onShutdown();
+  worker::shutdown();   // first, so no asynchronous loads are running during shutdown.
+  watch::shutdown();
   gfx::shutdown();
   sfx::shutdown();
+  pak::close();
   log::shutdown();
 }
 
@@ -228,12 +449,15 @@ void Engine::run()
 
 void Engine::mainloop()
 {
-  auto frameStart = Clock_t::now();
-
   _gameClock.update(_realClock.update()); 
   auto gameNow = _gameClock.getNow();
   auto realNow = _realClock.getNow();
 
+  if(_isHotReloading){
+    PXR_PROFILE_SCOPE("engine::pollHotReload");
+    pollHotReload();
+  }
+
   SDL_Event event;
   while(SDL_PollEvent(&event) != 0){
     switch(event.type){
@@ -280,6 +504,10 @@ void Engine::mainloop()
           onSplashExit(); 
           break;
         }
+        else if(event.key.keysym.sym == exportProfileKey){
+          prof::exportChromeTrace(profileTracePath);
+          break;
+        }
         // FALLTHROUGH
       case SDL_KEYUP:
         input::onKeyEvent(event);
@@ -303,9 +531,141 @@ void Engine::mainloop()
     _framesDoneThisSecond = 0;
   }
 
-  auto framePeriod = Clock_t::now() - frameStart;
-  if(framePeriod < minFramePeriod)
-    std::this_thread::sleep_for(minFramePeriod - framePeriod); 
+  updateFrameTimeWindows(realNow);
+
+  if(!_isHeadless)
+    paceFrame();
+}
+
+//
+// Idles until the next update or draw tick is due. 
+//
+void Engine::paceFrame()
+{
+  //
+  // Ticks held back by the ticks per frame limit are due now.
+  //
+  if(_updateTicker.getTicksAccumulated() > 0 || _drawTicker.getTicksAccumulated() > 0)
+    return;
+
+  //
+  // With vsync the present of a frame drawn this loop already waited for the display refresh,
+  // so the next draw is due about now.
+  //
+  if(_isVsyncing && _drawTicker.getTicksDoneThisFrame() > 0)
+    return;
+
+  Duration_t deadline = _drawTicker.getNextTickNow();
+
+  //
+  // The update ticker runs on the game clock so its deadline depends on the game clock scale; 
+  // a paused (or reversed) game clock has no next update.
+  //
+  float scale = _gameClock.getScale();
+  if(!_gameClock.isPaused() && scale > 0.f){
+    Duration_t gameWait = _updateTicker.getNextTickNow() - _gameClock.getNow();
+    Duration_t updateDeadline = _realClock.getNow() + Duration_t{static_cast<int64_t>(gameWait.count() / scale)};
+    deadline = std::min(deadline, updateDeadline);
+  }
+
+  PXR_PROFILE_SCOPE("engine::pace");
+  _framePacer.waitUntil(_realClock.toTimePoint(deadline));
+}
+
+//
+// Applies the rc properties which can change whilst running; called on initialization and 
+// whenever the rc file is reloaded.
+//
+void Engine::applyRC()
+{
+  _clearColor = gfx::Color4u{
+    static_cast<uint8_t>(_rc.getIntValue(EngineRC::KEY_CLEAR_RED)),
+    static_cast<uint8_t>(_rc.getIntValue(EngineRC::KEY_CLEAR_GREEN)),
+    static_cast<uint8_t>(_rc.getIntValue(EngineRC::KEY_CLEAR_BLUE)),
+    255
+  };
+
+  int fpsLockHz = _rc.getIntValue(EngineRC::KEY_FPS_LOCK);
+  if(fpsLockHz != _fpsLockHz){
+    _fpsLockHz = fpsLockHz;
+    Duration_t tickPeriod {static_cast<int64_t>(1.0e9 / static_cast<double>(_fpsLockHz))};
+    _updateTicker.setTickPeriod(tickPeriod);
+    _drawTicker.setTickPeriod(tickPeriod);
+    log::log(log::INFO, log::msg_eng_locking_fps, std::to_string(_fpsLockHz) + "hz");
+  }
+
+  if(_isHeadless){
+    Duration_t tickPeriod {static_cast<int64_t>(1.0e9 / static_cast<double>(_fpsLockHz))};
+    _realClock.setSimulatedStep(tickPeriod);
+    _headlessFrameLimit = _rc.getIntValue(EngineRC::KEY_HEADLESS_FRAMES);
+    _headlessDumpPeriod = _rc.getIntValue(EngineRC::KEY_HEADLESS_DUMP_PERIOD);
+  }
+
+  _statsLogPeriod = oneSecond * _rc.getIntValue(EngineRC::KEY_STATS_LOG_PERIOD);
+
+  _isVsyncing = gfx::setVsync(_rc.getBoolValue(EngineRC::KEY_VSYNC));
+
+  if(_rc.getBoolValue(EngineRC::KEY_DRAW_COMMAND_BUFFER))
+    gfx::enableCommandBuffer();
+  else
+    gfx::disableCommandBuffer();
+}
+
+void Engine::reloadRC()
+{
+  EngineRC old {_rc};
+  _rc.load(EngineRC::filename);
+  log::log(log::INFO, log::msg_eng_reloaded_rc);
+
+  //
+  // The window (or lack of), worker threads and watcher are only created on initialization.
+  //
+  if(_rc.getIntValue(EngineRC::KEY_WINDOW_WIDTH) != old.getIntValue(EngineRC::KEY_WINDOW_WIDTH) ||
+     _rc.getIntValue(EngineRC::KEY_WINDOW_HEIGHT) != old.getIntValue(EngineRC::KEY_WINDOW_HEIGHT) ||
+     _rc.getBoolValue(EngineRC::KEY_FULLSCREEN) != old.getBoolValue(EngineRC::KEY_FULLSCREEN) ||
+     _rc.getIntValue(EngineRC::KEY_WORKER_THREADS) != old.getIntValue(EngineRC::KEY_WORKER_THREADS) ||
+     _rc.getBoolValue(EngineRC::KEY_HOT_RELOAD) != old.getBoolValue(EngineRC::KEY_HOT_RELOAD) ||
+     _rc.getBoolValue(EngineRC::KEY_HEADLESS) != old.getBoolValue(EngineRC::KEY_HEADLESS))
+  {
+    log::log(log::WARN, log::msg_eng_rc_needs_restart);
+  }
+
+  applyRC();
+}
+
+//
+// Dispatches the files changed since the last frame to their reloads. Reloaded resources are 
+// swapped in at the end of a present, i.e. between frames.
+//
+void Engine::pollHotReload()
+{
+  std::vector<std::string> changedFiles {};
+  watch::poll(changedFiles);
+  if(changedFiles.empty())
+    return;
+
+  //
+  // A spritesheet changes as two files (the bmp and the xml) and editors may write a file more
+  // than once, so reloads are only issued once per resource per frame.
+  //
+  std::sort(changedFiles.begin(), changedFiles.end());
+  std::string lastResource {};
+  for(const auto& file : changedFiles){
+    std::size_t split = file.find_last_of('/') + 1;
+    std::string directory {file.substr(0, split)};
+    std::string stem {file.substr(split, file.find_last_of('.') - split)};
+    std::string resource {directory + stem};
+    if(stem.empty() || resource == lastResource)
+      continue;
+    lastResource = resource;
+
+    if(directory == gfx::RESOURCE_PATH_SPRITESHEETS)
+      gfx::reloadSpritesheet(stem.c_str());
+    else if(directory == gfx::RESOURCE_PATH_FONTS)
+      gfx::reloadFont(stem.c_str());
+    else if(directory == io::RESOURCE_PATH_RC && stem == EngineRC::filename)
+      reloadRC();
+  }
 }
 
 void Engine::drawEngineStats()
@@ -328,6 +688,22 @@ void Engine::drawEngineStats()
 
   std::stringstream().swap(ss);
 
+  ss << std::setprecision(3);
+  ss << "dirty pixels uploaded: " << (gfx::getDirtyRatio() * 100.f) << "%";
+  gfx::drawText({10, 30}, ss.str(), _engineFontKey, gfx::colors::white, _statsScreenId);
+
+  std::stringstream().swap(ss);
+
+  gfx::FontCacheStats fontCache = gfx::getFontCacheStats();
+  long fontCacheLookups = fontCache._hits + fontCache._misses;
+  ss << std::setprecision(3);
+  ss << "font cache: hits=" << fontCache._hits << " misses=" << fontCache._misses
+     << " hit rate=" << (fontCacheLookups ? (fontCache._hits * 100.f) / fontCacheLookups : 0.f) << "%"
+     << " entries=" << fontCache._entryCount << "/" << fontCache._capacity;
+  gfx::drawText({10, 40}, ss.str(), _engineFontKey, gfx::colors::white, _statsScreenId);
+
+  std::stringstream().swap(ss);
+
   int gameHours, gameMins, gameSecs, realHours, realMins, realSecs;
   durationToDigitalClock(_gameClock.getNow(), gameHours, gameMins, gameSecs);
   durationToDigitalClock(_realClock.getNow(), realHours, realMins, realSecs);
@@ -337,9 +713,99 @@ void Engine::drawEngineStats()
                  << " -- real=" << realHours << ":" << realMins << ":" << realSecs;
   gfx::drawText({10, 10}, ss.str(), _engineFontKey, gfx::colors::white, _statsScreenId);
 
+  FrameTimes frameTimes {_lastStatsWindowTimes};
+  frameTimes.add(_statsWindowTimes);
+  gfx::drawText({10, 50}, "draw [ms] -- " + frameTimes._draw.toString(), _engineFontKey, 
+                gfx::colors::white, _statsScreenId);
+  gfx::drawText({10, 60}, "update [ms] -- " + frameTimes._update.toString(), _engineFontKey, 
+                gfx::colors::white, _statsScreenId);
+  gfx::drawText({10, 70}, "frame [ms] -- " + frameTimes._frame.toString(), _engineFontKey, 
+                gfx::colors::white, _statsScreenId);
+
+  drawFrameTimeGraph();
+
+  std::stringstream().swap(ss);
+
+  ss << std::fixed << std::setprecision(3);
+  ss << "profile [ms] -- last frame=" << (prof::getFrameDuration() / 1.0e6);
+  gfx::drawText({10, 280}, ss.str(), _engineFontKey, gfx::colors::white, _statsScreenId);
+
+  const auto& breakdown = prof::getFrameBreakdown();
+  int scopeCount = std::min(static_cast<int>(breakdown.size()), maxStatsProfileScopes);
+  for(int i = 0; i < scopeCount; ++i){
+    std::stringstream().swap(ss);
+    ss << std::fixed << std::setprecision(3);
+    ss << breakdown[i]._name << " " << (breakdown[i]._duration / 1.0e6) << " x" << breakdown[i]._count;
+    gfx::drawText({20, 270 - (i * 10)}, ss.str(), _engineFontKey, gfx::colors::white, _statsScreenId);
+  }
+
   _needRedrawEngineStats = false;
 }
 
+//
+// Draws the last frameTimeGraphSize frame times as bars, oldest to newest from left to right, 
+// scaled so the frame period of the fps lock is half the graph height. Frames slower than the
+// fps lock are drawn red.
+//
+void Engine::drawFrameTimeGraph()
+{
+  static constexpr Vector2i graphPosition {10, 80};
+  static constexpr int graphHeight {60};
+
+  Duration_t targetPeriod {static_cast<int64_t>(1.0e9 / static_cast<double>(_fpsLockHz))};
+  Duration_t fullScale {targetPeriod * 2};
+
+  for(int i = 0; i < frameTimeGraphSize; ++i){
+    Duration_t frameTime = _frameTimeGraph[(_frameTimeGraphHead + i) % frameTimeGraphSize];
+    int barHeight = std::min(graphHeight, static_cast<int>((frameTime * graphHeight) / fullScale));
+    if(barHeight == 0)
+      continue;
+    gfx::Color4u color = (frameTime > targetPeriod) ? gfx::colors::red : gfx::colors::green;
+    Vector2i bottom {graphPosition._x + i, graphPosition._y};
+    Vector2i top {graphPosition._x + i, graphPosition._y + barHeight - 1};
+    gfx::drawLine(bottom, top, color, _statsScreenId);
+  }
+
+  int targetY = graphPosition._y + (graphHeight / 2);
+  gfx::drawLine(Vector2i{graphPosition._x, targetY}, 
+                Vector2i{graphPosition._x + frameTimeGraphSize - 1, targetY}, 
+                gfx::colors::gray, 
+                _statsScreenId);
+}
+
+//
+// Starts a new stats screen window every statsWindowPeriod and logs the frame times every 
+// stats log period.
+//
+void Engine::updateFrameTimeWindows(Duration_t realNow)
+{
+  if((realNow - _statsWindowStart) >= statsWindowPeriod){
+    _lastStatsWindowTimes = _statsWindowTimes;
+    _statsWindowTimes.reset();
+    _statsWindowStart = realNow;
+  }
+
+  if(_statsLogPeriod == Duration_t::zero()){
+    _logPeriodStart = realNow;
+    return;
+  }
+
+  if((realNow - _logPeriodStart) >= _statsLogPeriod){
+    log::log(log::INFO, log::msg_eng_frame_times, _logPeriodTimes.toString());
+    _logPeriodTimes.reset();
+    _logPeriodStart = realNow;
+  }
+}
+
+//
+// Records a duration into both the stats screen window and the log period frame times.
+//
+void Engine::recordFrameTime(DurationHistogram FrameTimes::* histogram, Duration_t duration)
+{
+  (_statsWindowTimes.*histogram).record(duration);
+  (_logPeriodTimes.*histogram).record(duration);
+}
+
 void Engine::drawPauseDialog()
 {
   static constexpr const char* dialogTxt = "PAUSED";
@@ -364,24 +830,96 @@ void Engine::drawPauseDialog()
 
 void Engine::onUpdateTick(float tickPeriodSeconds)
 {
+  PXR_PROFILE_SCOPE("engine::update");
+
+  TimePoint_t updateStart = Clock_t::now();
+
   double nowSeconds = durationToSeconds(_gameClock.getNow());
-  _game->onUpdate(nowSeconds, tickPeriodSeconds);
+  {
+    PXR_PROFILE_SCOPE("game::onUpdate");
+    _game->onUpdate(nowSeconds, tickPeriodSeconds);
+  }
   input::onUpdate();
   sfx::onUpdate(tickPeriodSeconds);
+
+  recordFrameTime(&FrameTimes::_update, Clock_t::now() - updateStart);
 }
 
 void Engine::onDrawTick(float tickPeriodSeconds)
 {
+  //
+  // The profiler frames span from one draw to the next, so the breakdown includes all updates
+  // and idling between draws.
+  //
+  prof::beginFrame();
+
+  PXR_PROFILE_SCOPE("engine::draw");
+
+  TimePoint_t drawStart = Clock_t::now();
+  if(_lastDrawStart != TimePoint_t{}){
+    Duration_t frameTime = drawStart - _lastDrawStart;
+    recordFrameTime(&FrameTimes::_frame, frameTime);
+    _frameTimeGraph[_frameTimeGraphHead] = frameTime;
+    _frameTimeGraphHead = (_frameTimeGraphHead + 1) % frameTimeGraphSize;
+  }
+  _lastDrawStart = drawStart;
+
   gfx::clearWindowColor(_clearColor);
 
   double nowSeconds = durationToSeconds(_gameClock.getNow());
-  _game->onDraw(nowSeconds, tickPeriodSeconds);
+  float alpha = _updateTicker.getTickAlpha(_gameClock.getNow());
+  {
+    PXR_PROFILE_SCOPE("game::onDraw");
+    _game->onDraw(nowSeconds, tickPeriodSeconds, alpha);
+  }
 
-  if(_isDrawingEngineStats)
+  if(_isDrawingEngineStats){
+    PXR_PROFILE_SCOPE("engine::drawStats");
     drawEngineStats();
+  }
 
   gfx::present();
 
+  recordFrameTime(&FrameTimes::_draw, Clock_t::now() - drawStart);
+
+  if(_isHeadless){
+    ++_headlessFramesDrawn;
+    if(_headlessDumpPeriod != 0 && (_headlessFramesDrawn % _headlessDumpPeriod) == 0)
+      dumpScreens();
+    if(_headlessFrameLimit != 0 && _headlessFramesDrawn >= _headlessFrameLimit){
+      Duration_t wall = Clock_t::now() - _headlessWallStart;
+      std::stringstream ss {};
+      ss << std::setprecision(4) 
+         << "frames=" << _headlessFramesDrawn 
+         << " wall=" << durationToSeconds(wall) << "s"
+         << " avg=" << durationToMilliseconds(wall) / _headlessFramesDrawn << "ms";
+      log::log(log::INFO, log::msg_eng_headless_done, ss.str());
+      prof::exportChromeTrace(profileTracePath);
+      _isDone = true;
+    }
+  }
+}
+
+//
+// Dumps all enabled screens of the frame just presented to the headless dump directory.
+//
+void Engine::dumpScreens()
+{
+  std::error_code ec {};
+  std::filesystem::create_directories(headlessDumpPath, ec);
+  if(ec){
+    log::log(log::ERROR, log::msg_eng_fail_create_dump_dir, ec.message());
+    return;
+  }
+
+  for(int screenid = 0; screenid < gfx::getScreenCount(); ++screenid){
+    if(!gfx::isScreenEnabled(screenid))
+      continue;
+    std::stringstream ss {};
+    ss << headlessDumpPath << "/frame" << std::setw(6) << std::setfill('0') << _headlessFramesDrawn
+       << "_screen" << screenid << io::Bmp::FILE_EXTENSION;
+    gfx::dumpScreen(screenid, ss.str());
+  }
 }
 
 void Engine::onSplashUpdateTick(float tickPeriodSeconds)
@@ -420,6 +958,8 @@ void Engine::onSplashUpdateTick(float tickPeriodSeconds)
 
 void Engine::onSplashDrawTick(float tickPeriodSeconds)
 {
+  prof::beginFrame();
+
   gfx::clearWindowColor(gfx::colors::silver);
   gfx::clearScreenShade(1, _pauseScreenId);
   
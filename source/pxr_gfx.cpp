@@ -1,17 +1,26 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_opengl.h>
 #include <vector>
+#include <deque>
 #include <array>
-#include <map>
 #include <string>
 #include <cstring>
 #include <sstream>
 #include <cinttypes>
 #include <limits>
 #include <cassert>
+#include <string_view>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <iomanip>
 
 #include <chrono>
 
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
 #include "pxr_xml.h"
 #include "pxr_gfx.h"
 #include "pxr_vec.h"
@@ -19,6 +28,11 @@
 #include "pxr_color.h"
 #include "pxr_bmp.h"
 #include "pxr_log.h"
+#include "pxr_worker.h"
+#include "pxr_restable.h"
+#include "pxr_name.h"
+#include "pxr_pak.h"
+#include "pxr_prof.h"
 
 using namespace tinyxml2;
 using namespace pxr::io;
@@ -46,57 +60,254 @@ static Vector2i windowSize;
 static bool fullscreen;
 static int minPixelSize;
 static int maxPixelSize;
+static int maxTextureSize;
 static SDL_Window* window;
 static SDL_GLContext glContext;
+static bool isHeadlessMode {false};   // no window or opengl context; see initializeHeadless.
 static iRect viewport;
 static std::vector<Screen> screens;
 
+//
+// Texture coordinates of the screen quads; constant for all screens since each screen texture is
+// sized to exactly match the screen resolution. Ordered to match Screen::_quadPositions.
+//
+static constexpr GLfloat quadTexCoords[8] {0.f, 0.f, 1.f, 0.f, 0.f, 1.f, 1.f, 1.f};
+
+//
+// Command buffer mode; see enableCommandBuffer. Each thread draws this many bands of each 
+// screen on average when commands are flushed.
+//
+static bool isCommandBufferEnabled {false};
+static constexpr int BANDS_PER_THREAD = 2;
+
+//
+// Totals over all enabled screens for the last call to present; used for the dirty ratio stat.
+//
+static int pxUploadedLastPresent {0};
+static int pxCountLastPresent {0};
+
+//
+// Resources loaded asynchronously are LOADING until their load completes and is published, 
+// after which they are either LOADED or FAILED. Resources which are not LOADED resolve to the
+// error resources.
+//
+enum class LoadState
+{
+  LOADED,
+  LOADING,
+  FAILED
+};
+
 struct SpritesheetResource
 {
   Spritesheet _sheet;
-  std::string _name;
+  name::NameID_t _nameid;
   int _referenceCount;
+  LoadState _state;
+  int _atlasPage {-1};    // index of the atlas page the sheet's image views, if packed.
+  long _loadSequence {0}; // sequence number of the last async load published; see AsyncLoad.
 };
 
 struct FontResource
 {
   Font _font;
-  std::string _name;
+  name::NameID_t _nameid;
   int _referenceCount;
+  LoadState _state;
+  long _loadSequence {0};
 };
 
-static ResourceKey_t nextResourceKey {0};
+//
+// Resource keys are handles into these tables; see ResourceTable.
+//
+static ResourceTable<SpritesheetResource> spritesheets;
+static ResourceTable<FontResource> fonts;
 
-static std::map<ResourceKey_t, SpritesheetResource> spritesheets;
-static std::map<ResourceKey_t, FontResource> fonts;
+//
+// Maps the interned names of loaded resources to their keys; used to find loaded resources.
+//
+static name::KeyMap<ResourceKey_t> spritesheetKeys;
+static name::KeyMap<ResourceKey_t> fontKeys;
 
 static constexpr const char* errorSpritesheetName {"error_spritesheet"};
 static constexpr const char* errorFontName {"error_font"};
 
 static ResourceKey_t errorSpritesheetKey;
+static ResourceKey_t errorFontKey;
 static SpritesheetResource errorSpritesheet;
 static FontResource errorFont;
 
+//
+// Pages of packed spritesheet images; see packSpritesheets. The images of packed sheets are 
+// views into a page, and a page is freed once all sheets packed into it are unloaded, reloaded
+// or repacked.
+//
+struct AtlasPage
+{
+  io::Bmp _image;
+  int _sheetCount;
+};
+
+static constexpr int ATLAS_PAGE_MAX_SIZE {1024};
+
+//
+// Sheets whose opaque runs are shorter than this on average are drawn with the keyed row
+// blitters rather than by copying runs; see Spritesheet.
+//
+static constexpr int KEYED_BLIT_MAX_MEAN_RUN_LENGTH {32};
+
+static std::deque<AtlasPage> atlasPages;    // a deque so pages never move.
+
+//
+// Incremented whenever a resource is unloaded (or its data otherwise changes); used to detect
+// stale pointers to resources cached outside of the resource maps.
+//
+static long resourceGeneration {0};
+
+//
+// A font whose glyphs have been pre-tinted to a color and encoded as sprites (one per glyph, 
+// in ascii order) so text of that color can be drawn by copying opaque runs rather than by 
+// testing the alpha of every glyph pixel; see drawText.
+//
+// The tinted fonts are held in a small fixed size cache evicting the least recently used entry.
+// When the command buffer is enabled, entries used since its last flush are pinned since 
+// recorded commands point to them. Entries built before a resource was unloaded or reloaded are
+// stale.
+//
+// Tinting a font costs far more than drawing one string untinted, so a color is only admitted
+// on its second miss among the recent misses; colors which change every frame (e.g. fades and
+// flashes) are drawn untinted rather than evicting the entries of steady colors.
+//
+struct TintedFont
+{
+  ResourceKey_t _fontKey {-1};
+  Color4u _color;
+  Spritesheet _sheet;
+  long _generation {0};
+  long _lastUseTick {0};
+  long _lastUseFlush {-1};
+};
+
+static constexpr int TINTED_FONT_CACHE_SIZE {8};
+static constexpr int TINTED_FONT_MISS_HISTORY_SIZE {16};
+
+struct TintedFontMiss
+{
+  ResourceKey_t _fontKey {-1};
+  Color4u _color;
+};
+
+static std::array<TintedFont, TINTED_FONT_CACHE_SIZE> tintedFonts;
+static std::array<TintedFontMiss, TINTED_FONT_MISS_HISTORY_SIZE> tintedFontMissHistory;
+static int tintedFontMissHead {0};
+static long tintedFontTick {0};
+static long tintedFontHits {0};
+static long tintedFontMisses {0};
+static long flushCount {0};
+
+//
+// An asynchronous load in flight. The loading task has sole access to _data and _isRead until
+// it sets _isDone (release); the main thread polls _isDone (acquire) and only then takes the 
+// data, thus no locks are needed to publish the loaded resource.
+//
+// Reloads replace the data of a loaded resource; see reloadSpritesheet. Loads of the same 
+// resource may complete out of order (e.g. a reload issued whilst the initial load is running),
+// thus each load is numbered in the order it was issued and loads older than the last load
+// published to their resource are discarded.
+//
+template<typename T>
+struct AsyncLoad
+{
+  ResourceKey_t _key;
+  T _data;
+  bool _isRead;
+  bool _isReload;
+  long _sequence;
+  std::atomic<bool> _isDone;
+};
+
+static long asyncLoadSequence {0};
+
+static std::vector<std::unique_ptr<AsyncLoad<Spritesheet>>> spritesheetLoads;
+static std::vector<std::unique_ptr<AsyncLoad<Font>>> fontLoads;
+
+//
+// Counts of the asynchronous loads started and completed since there were last no loads in 
+// flight; used to calculate load progress.
+//
+static int asyncLoadsStarted {0};
+static int asyncLoadsCompleted {0};
+
 /////////////////////////////////////////////////////////////////////////////////////////////////
 //
 // MODULE FUNCTIONS
 //
 /////////////////////////////////////////////////////////////////////////////////////////////////
 
-static Color4u pxShaderDefault(Color4u color, int pxx, int pxy)
+static void pxShaderDefault(Color4u* span, int count, int pxx, int pxy)
 {
-  return color;
 }
 
 static void setViewport(iRect viewport)
 {
+  pxr::gfx::viewport = viewport;
+  if(isHeadlessMode)
+    return;
+
   glMatrixMode(GL_PROJECTION);
   glLoadIdentity();
   glOrtho(0.0, viewport._w, 0.0, viewport._h, -1.0, 1.0);
   glMatrixMode(GL_MODELVIEW);
   glLoadIdentity();
   glViewport(viewport._x, viewport._y, viewport._w, viewport._h);
-  pxr::gfx::viewport = viewport;
+}
+
+//
+// Chooses between drawing the sheet's sprites by copying runs or with the keyed row blitters
+// from the mean length of its runs; see Spritesheet.
+//
+static void chooseSpriteBlit(Spritesheet& sheet)
+{
+  long runPixels {0};
+  for(const auto& run : sheet._runs)
+    runPixels += run._length;
+  long runCount = sheet._runs.size();
+  sheet._isKeyedBlit = runCount > 0 && runPixels < runCount * KEYED_BLIT_MAX_MEAN_RUN_LENGTH;
+}
+
+//
+// Encodes every sprite in a sheet into rows of opaque runs; see Spritesheet. Returns the memory
+// overhead of the encoding in bytes.
+//
+static std::size_t encodeSpriteRuns(Spritesheet& sheet)
+{
+  sheet._runs.clear();
+  sheet._rowRuns.clear();
+
+  int stride = sheet._image.getStride();
+
+  for(auto& sprite : sheet._sprites){
+    sprite._rowRunsBase = sheet._rowRuns.size();
+    for(int spriteRow = 0; spriteRow < sprite._size._y; ++spriteRow){
+      sheet._rowRuns.push_back(sheet._runs.size());
+      int sheetRow = sprite._position._y + spriteRow;
+      const Color4u* rowPxs = sheet._image.getRow(sheetRow) + sprite._position._x;
+      int col {0};
+      while(col < sprite._size._x){
+        while(col < sprite._size._x && rowPxs[col]._a == ALPHA_KEY) ++col;
+        if(col == sprite._size._x) break;
+        int start = col;
+        while(col < sprite._size._x && rowPxs[col]._a != ALPHA_KEY) ++col;
+        int pixelOffset = (sprite._position._x + start) + (sheetRow * stride);
+        sheet._runs.push_back(SpriteRun{start, col - start, pixelOffset});
+      }
+    }
+    sheet._rowRuns.push_back(sheet._runs.size());
+  }
+
+  chooseSpriteBlit(sheet);
+
+  return (sheet._runs.size() * sizeof(SpriteRun)) + (sheet._rowRuns.size() * sizeof(int));
 }
 
 // 
@@ -115,13 +326,14 @@ static void genErrorSpritesheet()
 
   resource._sheet._image.create(sprite._size, colors::red);
   resource._sheet._sprites.push_back(sprite);
+  encodeSpriteRuns(resource._sheet);
 
-  resource._name = errorSpritesheetName;
+  name::NameID_t nameid = name::intern(errorSpritesheetName);
+  resource._nameid = nameid;
   resource._referenceCount = 0;
 
-  errorSpritesheetKey = nextResourceKey++;
-
-  spritesheets.emplace(std::make_pair(errorSpritesheetKey, resource));
+  errorSpritesheetKey = spritesheets.insert(std::move(resource));
+  spritesheetKeys.insert(nameid, errorSpritesheetKey);
 }
 
 //
@@ -146,10 +358,12 @@ static void genErrorFont()
     glyph._xadvance = 8;
   }
 
-  resource._name = errorFontName;
+  name::NameID_t nameid = name::intern(errorFontName);
+  resource._nameid = nameid;
   resource._referenceCount = 0;
 
-  fonts.emplace(std::make_pair(nextResourceKey++, resource));
+  errorFontKey = fonts.insert(std::move(resource));
+  fontKeys.insert(nameid, errorFontKey);
 }
 
 bool initialize(std::string windowTitle_, Vector2i windowSize_, bool fullscreen_)
@@ -216,18 +430,28 @@ bool initialize(std::string windowTitle_, Vector2i windowSize_, bool fullscreen_
   const char* glVendor {reinterpret_cast<const char*>(glGetString(GL_VENDOR))};
   log::log(log::INFO, log::msg_gfx_opengl_vendor, glVendor);
 
-  GLfloat params[2];
-  glGetFloatv(GL_ALIASED_POINT_SIZE_RANGE, params);
-  minPixelSize = params[0];
-  maxPixelSize = params[1];
+  //
+  // Screens are drawn as textured quads thus a virtual pixel can be any size which still fits
+  // within the largest possible viewport.
+  //
+  GLint params[2];
+  glGetIntegerv(GL_MAX_VIEWPORT_DIMS, params);
+  minPixelSize = 1;
+  maxPixelSize = std::min(params[0], params[1]);
   std::stringstream().swap(ss);
   ss << "[min:" << minPixelSize << ",max:" << maxPixelSize << "]";
   log::log(log::INFO, log::msg_gfx_pixel_size_range, std::string{ss.str()});
 
+  glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+  log::log(log::INFO, log::msg_gfx_max_texture_size, std::to_string(maxTextureSize));
+
   setViewport(iRect{0, 0, windowSize._x, windowSize._y});
 
   glEnableClientState(GL_VERTEX_ARRAY);
-  glEnableClientState(GL_COLOR_ARRAY);
+  glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+  glEnable(GL_TEXTURE_2D);
+  glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
   glEnable(GL_ALPHA_TEST);
   glAlphaFunc(GL_GREATER, 0.f);
 
@@ -237,25 +461,65 @@ bool initialize(std::string windowTitle_, Vector2i windowSize_, bool fullscreen_
   return true;
 }
 
+bool initializeHeadless(Vector2i windowSize_)
+{
+  log::log(log::INFO, log::msg_gfx_initializing);
+  log::log(log::INFO, log::msg_gfx_headless);
+
+  isHeadlessMode = true;
+  windowSize = windowSize_;
+  windowTitle = std::string{};
+  fullscreen = false;
+
+  //
+  // Screens are never uploaded to textures so are limited only by memory.
+  //
+  minPixelSize = 1;
+  maxPixelSize = std::max(windowSize._x, windowSize._y);
+  maxTextureSize = std::numeric_limits<int>::max();
+
+  setViewport(iRect{0, 0, windowSize._x, windowSize._y});
+
+  genErrorSpritesheet();
+  genErrorFont();
+
+  return true;
+}
+
+bool isHeadless()
+{
+  return isHeadlessMode;
+}
+
 static void freeScreens()
 {
   for(auto& screen : screens){
     delete[] screen._pxColors;
-    delete[] screen._pxPositions;
     screen._pxColors = nullptr;
-    screen._pxPositions = nullptr;
+    if(!isHeadlessMode)
+      glDeleteTextures(1, &screen._texture);
+    screen._texture = 0;
+    delete[] screen._dirtyTiles;
+    screen._dirtyTiles = nullptr;
+    delete[] screen._ppColors;
+    screen._ppColors = nullptr;
+    screen._commands.clear();
+    screen._commandText.clear();
+    screen._commandVertices.clear();
   }
 }
 
 void shutdown()
 {
   freeScreens();
+  if(isHeadlessMode)
+    return;
   SDL_GL_DeleteContext(glContext);
   SDL_DestroyWindow(window);
 }
 
 //
-// Recalculates screen position, pixel size, pixel positions etc to a account for a change in 
+// Recalculates screen position, pixel size, quad positions etc to a account for a change in 
 // window size, display resolution or screen mode attributes.
 //
 static void autoAdjustScreen(Vector2i windowSize, Screen& screen)
@@ -299,25 +563,158 @@ static void autoAdjustScreen(Vector2i windowSize, Screen& screen)
   }
 
   //
-  // Pixels are drawn as an array of points of _pxSize diameter. When drawing points in opengl, 
-  // the position of the point is taken as the center position. For odd pixel sizes e.g. 7 the 
-  // center pixel is simply 3,3 (= floor(7/2)). For even pixel sizes e.g. 8 the center of the 
-  // pixel is considered the bottom-left pixel in the top-right quadrant, i.e. 4,4 (= floor(8/2)).
+  // The screen is drawn as a single quad covering all its (scaled) virtual pixels. The texture
+  // is sampled with nearest filtering so each virtual pixel maps to a solid block of _pxSize 
+  // real pixels.
   //
-  int pixelCenterOffset = screen._pxSize / 2;
+  int x0 = screen._position._x;
+  int y0 = screen._position._y;
+  int x1 = x0 + (screen._resolution._x * screen._pxSize);
+  int y1 = y0 + (screen._resolution._y * screen._pxSize);
+  screen._quadPositions[0] = Vector2i{x0, y0};
+  screen._quadPositions[1] = Vector2i{x1, y0};
+  screen._quadPositions[2] = Vector2i{x0, y1};
+  screen._quadPositions[3] = Vector2i{x1, y1};
+}
+
+//
+// Creates the streaming texture a screen's pixel colors are uploaded to every present. The
+// texture matches the screen resolution exactly so no padding or texcoord scaling is needed.
+// Headless screens have no texture.
+//
+static void createScreenTexture(Screen& screen)
+{
+  if(isHeadlessMode)
+    return;
+  glGenTextures(1, &screen._texture);
+  glBindTexture(GL_TEXTURE_2D, screen._texture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, screen._resolution._x, screen._resolution._y, 0, 
+               GL_RGBA, GL_UNSIGNED_BYTE, screen._pxColors);
+}
+
+//
+// Marks all tiles of a screen which overlap the pixel region [xmin,xmax]x[ymin,ymax] (inclusive)
+// as dirty. The region is clamped to the screen thus callers can pass unclipped draw bounds.
+//
+static void markDirty(Screen& screen, int xmin, int ymin, int xmax, int ymax)
+{
+  xmin = std::max(xmin, 0);
+  ymin = std::max(ymin, 0);
+  xmax = std::min(xmax, screen._resolution._x - 1);
+  ymax = std::min(ymax, screen._resolution._y - 1);
+  if(xmin > xmax || ymin > ymax)
+    return;
+
+  int colmin = xmin / SCREEN_TILE_SIZE;
+  int colmax = xmax / SCREEN_TILE_SIZE;
+  int rowmin = ymin / SCREEN_TILE_SIZE;
+  int rowmax = ymax / SCREEN_TILE_SIZE;
+  for(int row = rowmin; row <= rowmax; ++row)
+    memset(screen._dirtyTiles + colmin + (row * screen._tileGrid._x), 1, colmax - colmin + 1);
+}
+
+static void markDirtyPixel(Screen& screen, int x, int y)
+{
+  screen._dirtyTiles[(x / SCREEN_TILE_SIZE) + ((y / SCREEN_TILE_SIZE) * screen._tileGrid._x)] = 1;
+}
+
+static void markAllDirty(Screen& screen)
+{
+  memset(screen._dirtyTiles, 1, screen._tileGrid._x * screen._tileGrid._y);
+}
 
-  for(int row = 0; row < screen._resolution._y; ++row){
-    for(int col = 0; col < screen._resolution._x; ++col){
-      Vector2i& pxPosition = screen._pxPositions[col + (row * screen._resolution._x)];
-      pxPosition._x = screen._position._x + (col * screen._pxSize) + pixelCenterOffset;
-      pxPosition._y = screen._position._y + (row * screen._pxSize) + pixelCenterOffset;
+//
+// Calls f(x, y, w, h) with the region of each run of adjacent dirty tiles in a row of tiles of
+// a screen.
+//
+template<typename F>
+static void forEachDirtyRun(const Screen& screen, int row, F f)
+{
+  const uint8_t* tiles = screen._dirtyTiles + (row * screen._tileGrid._x);
+  int col = 0;
+  while(col < screen._tileGrid._x){
+    if(!tiles[col]){
+      ++col;
+      continue;
     }
+    int runStart = col;
+    while(col < screen._tileGrid._x && tiles[col]) 
+      ++col;
+
+    int x = runStart * SCREEN_TILE_SIZE;
+    int y = row * SCREEN_TILE_SIZE;
+    int w = std::min(col * SCREEN_TILE_SIZE, screen._resolution._x) - x;
+    int h = std::min(y + SCREEN_TILE_SIZE, screen._resolution._y) - y;
+    f(x, y, w, h);
+  }
+}
+
+//
+// Runs the post-process chain of a screen over a region of the screen. Each row of the region 
+// of drawn pixels is copied into the post-process buffer and shaded there by each effect in
+// turn.
+//
+static void postProcessRegion(Screen& screen, int x, int y, int w, int h)
+{
+  for(int row = y; row < y + h; ++row){
+    int offset = x + (row * screen._resolution._x);
+    Color4u* span = screen._ppColors + offset;
+    memcpy(static_cast<void*>(span), static_cast<const void*>(screen._pxColors + offset), w * sizeof(Color4u));
+    for(PXShader_t effect : screen._postProcesses)
+      effect(span, w, x, row);
+  }
+}
+
+//
+// Runs the post-process chain of a screen over its dirty tiles ahead of the upload. Rows of
+// tiles are independent so are processed in parallel by the worker pool (see pxr_worker.h), 
+// thus effects must not write to shared state.
+//
+static void postProcessDirtyTiles(Screen& screen)
+{
+  if(screen._postProcesses.empty())
+    return;
+
+  PXR_PROFILE_SCOPE("gfx::postProcess");
+  worker::parallelFor(screen._tileGrid._y, [&screen](int row){
+    forEachDirtyRun(screen, row, [&screen](int x, int y, int w, int h){
+      postProcessRegion(screen, x, y, w, h);
+    });
+  });
+}
+
+//
+// Uploads the dirty regions of a screen to its texture and clears its dirty tiles. Each row of
+// tiles is uploaded as a set of rectangles, one for each run of adjacent dirty tiles. Screens
+// with post-processes upload their post-processed pixels; see postProcessDirtyTiles.
+//
+static void uploadDirtyTiles(Screen& screen)
+{
+  const Color4u* pixels = screen._postProcesses.empty() ? screen._pxColors : screen._ppColors;
+  screen._pxUploaded = 0;
+  if(!isHeadlessMode)
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, screen._resolution._x);
+  for(int row = 0; row < screen._tileGrid._y; ++row){
+    forEachDirtyRun(screen, row, [&screen, pixels](int x, int y, int w, int h){
+      if(!isHeadlessMode)
+        glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, GL_RGBA, GL_UNSIGNED_BYTE, 
+                        pixels + x + (y * screen._resolution._x));
+      screen._pxUploaded += w * h;
+    });
   }
+  if(!isHeadlessMode)
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  memset(screen._dirtyTiles, 0, screen._tileGrid._x * screen._tileGrid._y);
 }
 
 int createScreen(Vector2i resolution)
 {
   assert(resolution._x > 0 && resolution._y > 0);
+  assert(resolution._x <= maxTextureSize && resolution._y <= maxTextureSize);
 
   screens.push_back(Screen{});
   ResourceKey_t screenid = screens.size() - 1;
@@ -334,13 +731,19 @@ int createScreen(Vector2i resolution)
   screen._pxManualSize = 1;
   screen._pxCount = screen._resolution._x * screen._resolution._y;
   screen._pxColors = new Color4u[screen._pxCount];
-  screen._pxPositions = new Vector2i[screen._pxCount];
+  screen._texture = 0;
+  screen._tileGrid._x = (resolution._x + SCREEN_TILE_SIZE - 1) / SCREEN_TILE_SIZE;
+  screen._tileGrid._y = (resolution._y + SCREEN_TILE_SIZE - 1) / SCREEN_TILE_SIZE;
+  screen._dirtyTiles = new uint8_t[screen._tileGrid._x * screen._tileGrid._y];
+  screen._pxUploaded = 0;
+  screen._ppColors = nullptr;
   screen._isEnabled = true;
 
   clearScreenTransparent(screenid); 
   autoAdjustScreen(windowSize, screen);
+  createScreenTexture(screen);
 
-  int memkib = ((screen._pxCount * sizeof(Color4u)) + (screen._pxCount * sizeof(Vector2i))) / 1024;
+  int memkib = (screen._pxCount * sizeof(Color4u)) / 1024;
 
   std::stringstream ss {};
   ss << "resolution:" << resolution._x << "x" << resolution._y << "vpx mem:" << memkib << "kib";
@@ -351,59 +754,49 @@ int createScreen(Vector2i resolution)
 
 static ResourceKey_t useErrorSpritesheet()
 {
-  for(auto& pair : spritesheets){
-    if(pair.second._name == errorSpritesheetName){
-      pair.second._referenceCount++;
-      std::string addendum = "ref count=" + std::to_string(pair.second._referenceCount);
-      log::log(log::INFO, log::msg_gfx_using_error_spritesheet, addendum);
-      return pair.first;
-    }
-  }
-  
-  assert(0);   // This would mean the error sprite has not been generated.
+  assert(spritesheets.isValid(errorSpritesheetKey));   // else error sheet not generated.
+  SpritesheetResource& resource = spritesheets[errorSpritesheetKey];
+  resource._referenceCount++;
+  std::string addendum = "ref count=" + std::to_string(resource._referenceCount);
+  log::log(log::INFO, log::msg_gfx_using_error_spritesheet, addendum);
+  return errorSpritesheetKey;
 }
 
 static ResourceKey_t useErrorFont()
 {
-  for(auto& resource : fonts){
-    if(resource.second._name == errorFontName){
-      resource.second._referenceCount++;
-      std::string addendum = "ref count=" + std::to_string(resource.second._referenceCount);
-      log::log(log::INFO, log::msg_gfx_using_error_font, addendum);
-      return resource.first;
-    }
-  }
-
-  assert(0);  // This would mean the error font has not been generated.
+  assert(fonts.isValid(errorFontKey));   // else error font not generated.
+  FontResource& resource = fonts[errorFontKey];
+  resource._referenceCount++;
+  std::string addendum = "ref count=" + std::to_string(resource._referenceCount);
+  log::log(log::INFO, log::msg_gfx_using_error_font, addendum);
+  return errorFontKey;
 }
 
-ResourceKey_t loadSpritesheet(ResourceName_t name)
+//
+// Returns the resource a valid key resolves to; the resource itself if it is loaded, else the
+// error resource.
+//
+static const SpritesheetResource& resolveSpritesheet(ResourceKey_t sheetKey)
 {
-  log::log(log::INFO, log::msg_gfx_loading_spritesheet, name);
-
-  for(auto& pair : spritesheets){
-    if(pair.second._name == name){
-      pair.second._referenceCount++;
-      std::string addendum {"ref count="};
-      addendum += std::to_string(pair.second._referenceCount);
-      log::log(log::INFO, log::msg_gfx_spritesheet_already_loaded, addendum);
-      return pair.first;
-    }
-  }
-
-  SpritesheetResource resource{};
-  Spritesheet& sheet = resource._sheet;
+  const SpritesheetResource& resource = spritesheets[sheetKey];
+  return resource._state == LoadState::LOADED ? resource : spritesheets[errorSpritesheetKey];
+}
 
-  resource._name = name;
-  resource._referenceCount = 1;
+static const FontResource& resolveFont(ResourceKey_t fontKey)
+{
+  const FontResource& resource = fonts[fontKey];
+  return resource._state == LoadState::LOADED ? resource : fonts[errorFontKey];
+}
 
+bool readSpritesheet(ResourceName_t name, Spritesheet& sheet)
+{
   std::string bmppath{};
   bmppath += RESOURCE_PATH_SPRITESHEETS;
   bmppath += name;
   bmppath += Bmp::FILE_EXTENSION;
   if(!sheet._image.load(bmppath)){
     log::log(log::ERROR, log::msg_gfx_fail_load_asset_bmp, name);
-    return useErrorSpritesheet();
+    return false;
   }
 
   std::string xmlpath {};
@@ -412,14 +805,14 @@ ResourceKey_t loadSpritesheet(ResourceName_t name)
   xmlpath += XML_RESOURCE_EXTENSION_SPRITESHEETS;
   XMLDocument doc{};
   if(!parseXmlDocument(&doc, xmlpath)) 
-    return useErrorSpritesheet();
+    return false;
 
   XMLElement* xmlsheet{nullptr};
   XMLElement* xmlsprite{nullptr};
 
   int err{0};
-  if(!extractChildElement(&doc, &xmlsheet, "spritesheet")) return useErrorSpritesheet();
-  if(!extractChildElement(xmlsheet, &xmlsprite, "sprite")) return useErrorSpritesheet();
+  if(!extractChildElement(&doc, &xmlsheet, "spritesheet")) return false;
+  if(!extractChildElement(xmlsheet, &xmlsprite, "sprite")) return false;
   do{
     Sprite sprite{};
     if(!extractIntAttribute(xmlsprite, "x", &sprite._position._x)){++err; break;}
@@ -432,7 +825,7 @@ ResourceKey_t loadSpritesheet(ResourceName_t name)
     xmlsprite = xmlsprite->NextSiblingElement("sprite");
   }
   while(xmlsprite != 0);
-  if(err) return useErrorSpritesheet();
+  if(err) return false;
 
   // 
   // Validate all sprites to avoid segfaults.
@@ -450,13 +843,171 @@ ResourceKey_t loadSpritesheet(ResourceName_t name)
 
   if(err){
     log::log(log::ERROR, log::msg_gfx_spritesheet_invalid_xml_bmp_mismatch, name);
-    return useErrorSpritesheet();
+    return false;
+  }
+
+  std::size_t runBytes = encodeSpriteRuns(sheet);
+  std::size_t pixelBytes = sheet._image.getStride() * sheet._image.getHeight() * sizeof(Color4u);
+  std::string runsAddendum {};
+  runsAddendum += "runs=";
+  runsAddendum += std::to_string(sheet._runs.size());
+  runsAddendum += " overhead=";
+  runsAddendum += std::to_string(runBytes);
+  runsAddendum += "B (";
+  runsAddendum += std::to_string(pixelBytes ? (runBytes * 100) / pixelBytes : 0);
+  runsAddendum += "% of pixel data)";
+  log::log(log::INFO, log::msg_gfx_spritesheet_runs, runsAddendum);
+
+  return true;
+}
+
+//
+// Returns true if count records of type T starting at byte offset lie within the data of an
+// archive entry and are suitably aligned. Counts are signed as they are read from the archive.
+//
+template<typename T>
+static bool isInEntry(const pak::Entry& entry, uint64_t offset, int64_t count)
+{
+  if(count < 0 || offset % alignof(T) != 0 || offset > entry._size)
+    return false;
+  return static_cast<uint64_t>(count) <= (entry._size - offset) / sizeof(T);
+}
+
+//
+// Returns true if the pixels of an archived image lie within the data of its entry.
+//
+static bool isValidArchivedImage(const pak::Entry& entry, const pak::ImageRecord& image)
+{
+  if(image._width < 0 || image._height < 0 || image._stride < image._width)
+    return false;
+  int64_t pixelCount = static_cast<int64_t>(image._stride) * image._height;
+  return isInEntry<Color4u>(entry, image._pixelsOffset, pixelCount);
+}
+
+//
+// Returns true if the archived spritesheet record has sprites and every offset, count and index
+// in it lies within the entry, so a truncated or corrupted archive cannot make the blitters 
+// read out of bounds.
+//
+static bool isValidArchivedSpritesheet(const pak::Entry& entry)
+{
+  const uint8_t* data = pak::getData(entry);
+  if(!isInEntry<pak::SpritesheetRecord>(entry, 0, 1))
+    return false;
+  const auto* record = reinterpret_cast<const pak::SpritesheetRecord*>(data);
+  if(record->_spriteCount <= 0 || !isValidArchivedImage(entry, record->_image) ||
+     !isInEntry<pak::SpriteRecord>(entry, record->_spritesOffset, record->_spriteCount) ||
+     !isInEntry<pak::RunRecord>(entry, record->_runsOffset, record->_runCount) ||
+     !isInEntry<int32_t>(entry, record->_rowRunsOffset, record->_rowRunCount))
+    return false;
+
+  const auto* sprites = reinterpret_cast<const pak::SpriteRecord*>(data + record->_spritesOffset);
+  const auto* runs = reinterpret_cast<const pak::RunRecord*>(data + record->_runsOffset);
+  const auto* rowRuns = reinterpret_cast<const int32_t*>(data + record->_rowRunsOffset);
+  int64_t pixelCount = static_cast<int64_t>(record->_image._stride) * record->_image._height;
+
+  for(int i = 0; i < record->_spriteCount; ++i){
+    const pak::SpriteRecord& sprite = sprites[i];
+    if(sprite._x < 0 || sprite._y < 0 || sprite._w < 0 || sprite._h < 0 ||
+       static_cast<int64_t>(sprite._x) + sprite._w > record->_image._width ||
+       static_cast<int64_t>(sprite._y) + sprite._h > record->_image._height)
+      return false;
+
+    //
+    // A sprite's row table has one entry per row plus an end entry.
+    //
+    if(sprite._rowRunsBase < 0 || 
+       static_cast<int64_t>(sprite._rowRunsBase) + sprite._h + 1 > record->_rowRunCount)
+      return false;
+
+    for(int row = 0; row < sprite._h; ++row){
+      int32_t runBegin = rowRuns[sprite._rowRunsBase + row];
+      int32_t runEnd = rowRuns[sprite._rowRunsBase + row + 1];
+      if(runBegin < 0 || runBegin > runEnd || runEnd > record->_runCount)
+        return false;
+      for(int r = runBegin; r < runEnd; ++r){
+        const pak::RunRecord& run = runs[r];
+        if(run._start < 0 || run._length <= 0 || run._pixelOffset < 0 ||
+           static_cast<int64_t>(run._start) + run._length > sprite._w ||
+           static_cast<int64_t>(run._pixelOffset) + run._length > pixelCount)
+          return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+//
+// Reads a spritesheet from its entry in the asset archive. The image is a view of the pixels in
+// the archive; the sprite and run tables are copied out as they are small. Returns false, 
+// leaving the sheet untouched, if the entry fails validation.
+//
+static bool readArchivedSpritesheet(const pak::Entry& entry, Spritesheet& sheet)
+{
+  if(!isValidArchivedSpritesheet(entry)){
+    log::log(log::WARN, log::msg_gfx_invalid_archive_entry, entry._name);
+    return false;
+  }
+
+  uint8_t* data = pak::getData(entry);
+  const auto* record = reinterpret_cast<const pak::SpritesheetRecord*>(data);
+  const auto* sprites = reinterpret_cast<const pak::SpriteRecord*>(data + record->_spritesOffset);
+  const auto* runs = reinterpret_cast<const pak::RunRecord*>(data + record->_runsOffset);
+  const auto* rowRuns = reinterpret_cast<const int32_t*>(data + record->_rowRunsOffset);
+  auto* pixels = reinterpret_cast<Color4u*>(data + record->_image._pixelsOffset);
+
+  sheet._image.view(pixels, Vector2i{record->_image._width, record->_image._height}, 
+                    record->_image._stride);
+
+  sheet._sprites.resize(record->_spriteCount);
+  for(int i = 0; i < record->_spriteCount; ++i){
+    Sprite& sprite = sheet._sprites[i];
+    sprite._position = Vector2i{sprites[i]._x, sprites[i]._y};
+    sprite._size = Vector2i{sprites[i]._w, sprites[i]._h};
+    sprite._origin = Vector2i{sprites[i]._ox, sprites[i]._oy};
+    sprite._rowRunsBase = sprites[i]._rowRunsBase;
+  }
+
+  sheet._runs.resize(record->_runCount);
+  for(int i = 0; i < record->_runCount; ++i)
+    sheet._runs[i] = SpriteRun{runs[i]._start, runs[i]._length, runs[i]._pixelOffset};
+
+  sheet._rowRuns.assign(rowRuns, rowRuns + record->_rowRunCount);
+
+  chooseSpriteBlit(sheet);
+
+  return true;
+}
+
+ResourceKey_t loadSpritesheet(ResourceName_t name)
+{
+  log::log(log::INFO, log::msg_gfx_loading_spritesheet, name);
+
+  name::NameID_t nameid = name::intern(name);
+  ResourceKey_t loadedKey = spritesheetKeys.find(nameid);
+  if(loadedKey != spritesheetKeys.nullKey){
+    SpritesheetResource& resource = spritesheets[loadedKey];
+    resource._referenceCount++;
+    std::string addendum {"ref count="};
+    addendum += std::to_string(resource._referenceCount);
+    log::log(log::INFO, log::msg_gfx_spritesheet_already_loaded, addendum);
+    return loadedKey;
   }
 
-  ResourceKey_t newKey = nextResourceKey;
-  ++nextResourceKey;
+  SpritesheetResource resource{};
+  Spritesheet& sheet = resource._sheet;
+
+  resource._nameid = nameid;
+  resource._referenceCount = 1;
+
+  const pak::Entry* entry = pak::find(pak::EntryType::SPRITESHEET, name);
+  bool isRead = (entry != nullptr && readArchivedSpritesheet(*entry, sheet)) || readSpritesheet(name, sheet);
+  if(!isRead)
+    return useErrorSpritesheet();
 
-  spritesheets.emplace(std::make_pair(newKey, std::move(resource)));
+  ResourceKey_t newKey = spritesheets.insert(std::move(resource));
+  spritesheetKeys.insert(nameid, newKey);
 
   std::string addendum{};
   addendum += "[name:key]=[";
@@ -469,47 +1020,127 @@ ResourceKey_t loadSpritesheet(ResourceName_t name)
   return newKey;
 }
 
+ResourceKey_t loadSpritesheetAsync(ResourceName_t name)
+{
+  log::log(log::INFO, log::msg_gfx_loading_spritesheet_async, name);
+
+  name::NameID_t nameid = name::intern(name);
+  ResourceKey_t loadedKey = spritesheetKeys.find(nameid);
+  if(loadedKey != spritesheetKeys.nullKey){
+    SpritesheetResource& resource = spritesheets[loadedKey];
+    resource._referenceCount++;
+    std::string addendum {"ref count="};
+    addendum += std::to_string(resource._referenceCount);
+    log::log(log::INFO, log::msg_gfx_spritesheet_already_loaded, addendum);
+    return loadedKey;
+  }
+
+  SpritesheetResource resource {};
+  resource._nameid = nameid;
+  resource._referenceCount = 1;
+  resource._state = LoadState::LOADING;
+  ResourceKey_t newKey = spritesheets.insert(std::move(resource));
+  spritesheetKeys.insert(nameid, newKey);
+
+  //
+  // The archive lookup is done here as the name registry is main thread only.
+  //
+  const pak::Entry* entry = pak::find(pak::EntryType::SPRITESHEET, name);
+
+  spritesheetLoads.push_back(std::make_unique<AsyncLoad<Spritesheet>>());
+  AsyncLoad<Spritesheet>* load = spritesheetLoads.back().get();
+  load->_key = newKey;
+  load->_sequence = ++asyncLoadSequence;
+  ++asyncLoadsStarted;
+
+  worker::submit([load, entry, filename = std::string{name}](){
+    load->_isRead = (entry != nullptr && readArchivedSpritesheet(*entry, load->_data)) ||
+                    readSpritesheet(filename.c_str(), load->_data);
+    load->_isDone.store(true, std::memory_order_release);
+  });
+
+  return newKey;
+}
+
+//
+// Executes any recorded commands; called before the data of a resource is freed or moved since
+// recorded commands point to it (see bindCommandResources).
+//
+static void flushRecordedCommands()
+{
+  if(isCommandBufferEnabled)
+    flushCommands();
+}
+
+static void releaseAtlasPage(SpritesheetResource& resource)
+{
+  if(resource._atlasPage == -1)
+    return;
+
+  AtlasPage& page = atlasPages[resource._atlasPage];
+  if(--page._sheetCount == 0)
+    page._image = io::Bmp{};
+  resource._atlasPage = -1;
+}
+
+static void releaseAtlasPage(FontResource&)
+{
+  // fonts are never packed into atlas pages.
+}
+
 void unloadSpritesheet(ResourceKey_t sheetKey)
 {
-  auto search = spritesheets.find(sheetKey);
-  if(search == spritesheets.end()){
+  SpritesheetResource* resource = spritesheets.find(sheetKey);
+  if(resource == nullptr){
     log::log(log::WARN, log::msg_gfx_unloading_nonexistent_resource, "key=" + std::to_string(sheetKey));
     return;
   }
 
-  SpritesheetResource& resource = search->second;
-  resource._referenceCount--;
-  if(resource._referenceCount <= 0 && resource._name != errorSpritesheetName){
+  resource->_referenceCount--;
+  if(resource->_referenceCount <= 0 && sheetKey != errorSpritesheetKey){
+    flushRecordedCommands();
     log::log(log::INFO, log::msg_gfx_unload_spritesheet_success, "key=" + std::to_string(sheetKey));
-    spritesheets.erase(search);
+    if(spritesheetKeys.find(resource->_nameid) == sheetKey)   // failed loads are unmapped.
+      spritesheetKeys.erase(resource->_nameid);
+    releaseAtlasPage(*resource);
+    spritesheets.erase(sheetKey);
+    ++resourceGeneration;
   }
 }
 
-ResourceKey_t loadFont(ResourceName_t name)
+bool reloadSpritesheet(ResourceName_t name)
 {
-  log::log(log::INFO, log::msg_gfx_loading_font, name);
+  name::NameID_t nameid = name::find(name);
+  ResourceKey_t loadedKey = spritesheetKeys.find(nameid);
+  if(loadedKey == spritesheetKeys.nullKey)
+    return false;
 
-  for(auto& resource : fonts){
-    if(resource.second._name == name){
-      log::log(log::INFO, log::msg_gfx_loading_font_success);
-      resource.second._referenceCount++;
-      return resource.first;
-    }
-  }
+  log::log(log::INFO, log::msg_gfx_reloading_spritesheet, name);
 
-  FontResource resource {};
-  Font& font = resource._font;
+  spritesheetLoads.push_back(std::make_unique<AsyncLoad<Spritesheet>>());
+  AsyncLoad<Spritesheet>* load = spritesheetLoads.back().get();
+  load->_key = loadedKey;
+  load->_sequence = ++asyncLoadSequence;
+  load->_isReload = true;
+  ++asyncLoadsStarted;
 
-  resource._name = name;
-  resource._referenceCount = 1;
+  worker::submit([load, filename = std::string{name}](){
+    load->_isRead = readSpritesheet(filename.c_str(), load->_data);
+    load->_isDone.store(true, std::memory_order_release);
+  });
+
+  return true;
+}
 
+bool readFont(ResourceName_t name, Font& font)
+{
   std::string bmppath{};
   bmppath += RESOURCE_PATH_FONTS;
   bmppath += name;
   bmppath += Bmp::FILE_EXTENSION;
-  if(!resource._font._image.load(bmppath)){
+  if(!font._image.load(bmppath)){
     log::log(log::ERROR, log::msg_gfx_fail_load_asset_bmp, name);
-    return useErrorFont();
+    return false;
   }
 
   std::string xmlpath {};
@@ -518,30 +1149,30 @@ ResourceKey_t loadFont(ResourceName_t name)
   xmlpath += XML_RESOURCE_EXTENSION_FONTS;
   XMLDocument doc{};
   if(!parseXmlDocument(&doc, xmlpath))
-    return useErrorFont();
+    return false;
 
   XMLElement* xmlfont{nullptr};
   XMLElement* xmlcommon{nullptr};
   XMLElement* xmlchars{nullptr};
   XMLElement* xmlchar{nullptr};
 
-  if(!extractChildElement(&doc, &xmlfont, "font")) return useErrorFont();
-  if(!extractChildElement(xmlfont, &xmlcommon, "common")) return useErrorFont();
-  if(!extractIntAttribute(xmlcommon, "lineHeight", &font._lineHeight)) return useErrorFont();
-  if(!extractIntAttribute(xmlcommon, "baseline", &font._baseLine)) return useErrorFont();
-  if(!extractIntAttribute(xmlcommon, "glyphspace", &font._glyphSpace)) return useErrorFont();
+  if(!extractChildElement(&doc, &xmlfont, "font")) return false;
+  if(!extractChildElement(xmlfont, &xmlcommon, "common")) return false;
+  if(!extractIntAttribute(xmlcommon, "lineHeight", &font._lineHeight)) return false;
+  if(!extractIntAttribute(xmlcommon, "baseline", &font._baseLine)) return false;
+  if(!extractIntAttribute(xmlcommon, "glyphspace", &font._glyphSpace)) return false;
 
   int charsCount {0};
-  if(!extractChildElement(xmlfont, &xmlchars, "chars")) return useErrorFont();
-  if(!extractIntAttribute(xmlchars, "count", &charsCount)) return useErrorFont();
+  if(!extractChildElement(xmlfont, &xmlchars, "chars")) return false;
+  if(!extractIntAttribute(xmlchars, "count", &charsCount)) return false;
 
   if(charsCount != ASCII_CHAR_COUNT){
     log::log(log::ERROR, log::msg_gfx_missing_ascii_glyphs, name);
-    return useErrorFont();
+    return false;
   }
 
   int charsRead{0}, err{0};
-  if(!extractChildElement(xmlchars, &xmlchar, "char")) return useErrorFont();
+  if(!extractChildElement(xmlchars, &xmlchar, "char")) return false;
   do{
     Glyph& glyph = font._glyphs[charsRead];
     if(!extractIntAttribute(xmlchar, "ascii", &glyph._ascii)){++err; break;}
@@ -556,7 +1187,7 @@ ResourceKey_t loadFont(ResourceName_t name)
     xmlchar = xmlchar->NextSiblingElement("char");
   }
   while(xmlchar != 0 && charsRead < ASCII_CHAR_COUNT);
-  if(err) return useErrorFont();
+  if(err) return false;
 
   std::sort(font._glyphs.begin(), font._glyphs.end(), [](const Glyph& g0, const Glyph& g1) {
     return g0._ascii < g1._ascii;
@@ -564,7 +1195,7 @@ ResourceKey_t loadFont(ResourceName_t name)
 
   if(charsRead != ASCII_CHAR_COUNT){
     log::log(log::ERROR, log::msg_gfx_missing_ascii_glyphs, name);
-    return useErrorFont();
+    return false;
   }
 
   // 
@@ -582,7 +1213,7 @@ ResourceKey_t loadFont(ResourceName_t name)
 
   if(err){
     log::log(log::ERROR, log::msg_gfx_font_invalid_xml_bmp_mismatch);
-    return useErrorFont();
+    return false;
   }
 
   //
@@ -595,369 +1226,1894 @@ ResourceKey_t loadFont(ResourceName_t name)
   }
   if(checksum != ASCII_CHAR_CHECKSUM){
     log::log(log::ERROR, log::msg_gfx_font_fail_checksum);
-    return useErrorFont();
+    return false;
   }
 
-  log::log(log::INFO, log::msg_gfx_loading_font_success);
+  return true;
+}
 
-  ResourceKey_t newKey = nextResourceKey;
-  ++nextResourceKey;
+//
+// Returns true if the glyph table and every glyph rect of an archived font record lie within
+// the entry and its image.
+//
+static bool isValidArchivedFont(const pak::Entry& entry)
+{
+  const uint8_t* data = pak::getData(entry);
+  if(!isInEntry<pak::FontRecord>(entry, 0, 1))
+    return false;
+  const auto* record = reinterpret_cast<const pak::FontRecord*>(data);
+  if(!isValidArchivedImage(entry, record->_image) ||
+     !isInEntry<pak::GlyphRecord>(entry, record->_glyphsOffset, record->_glyphCount))
+    return false;
 
-  fonts.emplace(std::make_pair(newKey, std::move(resource)));
+  const auto* glyphs = reinterpret_cast<const pak::GlyphRecord*>(data + record->_glyphsOffset);
+  for(int i = 0; i < record->_glyphCount; ++i){
+    const pak::GlyphRecord& g = glyphs[i];
+    if(g._x < 0 || g._y < 0 || g._width < 0 || g._height < 0 ||
+       static_cast<int64_t>(g._x) + g._width > record->_image._width ||
+       static_cast<int64_t>(g._y) + g._height > record->_image._height)
+      return false;
+  }
 
-  return newKey;
+  return true;
 }
 
-void unloadFont(ResourceKey_t fontKey)
+//
+// Reads a font from its entry in the asset archive. The image is a view of the pixels in the 
+// archive. Returns false, leaving the font untouched, if the entry fails validation.
+//
+static bool readArchivedFont(const pak::Entry& entry, Font& font)
 {
-  auto search = fonts.find(fontKey);
-  if(search == fonts.end()){
-    log::log(log::WARN, log::msg_gfx_unloading_nonexistent_resource, "font" + std::to_string(fontKey));
-    return;
+  if(!isValidArchivedFont(entry)){
+    log::log(log::WARN, log::msg_gfx_invalid_archive_entry, entry._name);
+    return false;
   }
 
-  FontResource& resource = search->second;
-  resource._referenceCount--;
-  if(resource._referenceCount <= 0 && resource._name != errorFontName){
-    log::log(log::INFO, log::msg_gfx_unload_font_success, "key=" + std::to_string(fontKey));
-    fonts.erase(search);
+  uint8_t* data = pak::getData(entry);
+  const auto* record = reinterpret_cast<const pak::FontRecord*>(data);
+  const auto* glyphs = reinterpret_cast<const pak::GlyphRecord*>(data + record->_glyphsOffset);
+  auto* pixels = reinterpret_cast<Color4u*>(data + record->_image._pixelsOffset);
+
+  if(record->_glyphCount != ASCII_CHAR_COUNT){
+    log::log(log::ERROR, log::msg_gfx_missing_ascii_glyphs, entry._name);
+    return false;
+  }
+
+  font._image.view(pixels, Vector2i{record->_image._width, record->_image._height}, 
+                   record->_image._stride);
+  font._lineHeight = record->_lineHeight;
+  font._baseLine = record->_baseLine;
+  font._glyphSpace = record->_glyphSpace;
+  for(int i = 0; i < ASCII_CHAR_COUNT; ++i){
+    const pak::GlyphRecord& g = glyphs[i];
+    font._glyphs[i] = Glyph{g._ascii, g._x, g._y, g._width, g._height, g._xoffset, g._yoffset, g._xadvance};
   }
+
+  return true;
 }
 
-const Font* getFont(ResourceKey_t fontKey)
+ResourceKey_t loadFont(ResourceName_t name)
 {
-  auto search = fonts.find(fontKey);
-  if(search == fonts.end()){
-    log::log(log::WARN, log::msg_gfx_unloading_nonexistent_resource, "font" + std::to_string(fontKey));
-    return nullptr;
+  log::log(log::INFO, log::msg_gfx_loading_font, name);
+
+  name::NameID_t nameid = name::intern(name);
+  ResourceKey_t loadedKey = fontKeys.find(nameid);
+  if(loadedKey != fontKeys.nullKey){
+    log::log(log::INFO, log::msg_gfx_loading_font_success);
+    fonts[loadedKey]._referenceCount++;
+    return loadedKey;
   }
-  return &(search->second._font);
+
+  FontResource resource {};
+  Font& font = resource._font;
+
+  resource._nameid = nameid;
+  resource._referenceCount = 1;
+
+  const pak::Entry* entry = pak::find(pak::EntryType::FONT, name);
+  bool isRead = (entry != nullptr && readArchivedFont(*entry, font)) || readFont(name, font);
+  if(!isRead)
+    return useErrorFont();
+
+  log::log(log::INFO, log::msg_gfx_loading_font_success);
+
+  ResourceKey_t newKey = fonts.insert(std::move(resource));
+  fontKeys.insert(nameid, newKey);
+
+  return newKey;
 }
 
-int getSpriteCount(ResourceKey_t sheetKey)
+ResourceKey_t loadFontAsync(ResourceName_t name)
 {
-  auto search = spritesheets.find(sheetKey);
-  assert(search != spritesheets.end());
-  return search->second._sheet._sprites.size();
+  log::log(log::INFO, log::msg_gfx_loading_font_async, name);
+
+  name::NameID_t nameid = name::intern(name);
+  ResourceKey_t loadedKey = fontKeys.find(nameid);
+  if(loadedKey != fontKeys.nullKey){
+    log::log(log::INFO, log::msg_gfx_loading_font_success);
+    fonts[loadedKey]._referenceCount++;
+    return loadedKey;
+  }
+
+  FontResource resource {};
+  resource._nameid = nameid;
+  resource._referenceCount = 1;
+  resource._state = LoadState::LOADING;
+  ResourceKey_t newKey = fonts.insert(std::move(resource));
+  fontKeys.insert(nameid, newKey);
+
+  const pak::Entry* entry = pak::find(pak::EntryType::FONT, name);
+
+  fontLoads.push_back(std::make_unique<AsyncLoad<Font>>());
+  AsyncLoad<Font>* load = fontLoads.back().get();
+  load->_key = newKey;
+  load->_sequence = ++asyncLoadSequence;
+  ++asyncLoadsStarted;
+
+  worker::submit([load, entry, filename = std::string{name}](){
+    load->_isRead = (entry != nullptr && readArchivedFont(*entry, load->_data)) ||
+                    readFont(filename.c_str(), load->_data);
+    load->_isDone.store(true, std::memory_order_release);
+  });
+
+  return newKey;
 }
 
-void onWindowResize(Vector2i windowSize)
+//
+// Moves the data of completed asynchronous loads into their resources. Loads of resources which
+// were unloaded while loading, or which were superseded by a newer load, are discarded. Failed
+// loads leave their resources resolving to the error resource and unmap their names so later 
+// loads retry; failed reloads instead leave their resources as they were.
+//
+template<typename T, typename Resource>
+static void publishAsyncLoads(std::vector<std::unique_ptr<AsyncLoad<T>>>& loads, 
+                              ResourceTable<Resource>& resources,
+                              name::KeyMap<ResourceKey_t>& keys,
+                              T Resource::* data)
 {
-  setViewport(iRect{0, 0, windowSize._x, windowSize._y});
-  for(auto& screen : screens)
-    autoAdjustScreen(windowSize, screen);
+  auto isPublished = [&resources, &keys, data](std::unique_ptr<AsyncLoad<T>>& load){
+    if(!load->_isDone.load(std::memory_order_acquire))
+      return false;
+
+    ++asyncLoadsCompleted;
+    Resource* resource = resources.find(load->_key);
+    if(resource == nullptr || load->_sequence < resource->_loadSequence)
+      return true;
+
+    const std::string& name = name::getString(resource->_nameid);
+    if(load->_isReload && !load->_isRead){
+      log::log(log::ERROR, log::msg_gfx_reload_fail, name);
+      return true;
+    }
+
+    resource->_loadSequence = load->_sequence;
+
+    if(load->_isRead){
+      resource->*data = std::move(load->_data);
+      resource->_state = LoadState::LOADED;
+      releaseAtlasPage(*resource);   // reloaded data replaces any packed image.
+      log::log(log::INFO, log::msg_gfx_async_load_success, name);
+    }
+    else{
+      resource->_state = LoadState::FAILED;
+      keys.erase(resource->_nameid);
+      log::log(log::ERROR, log::msg_gfx_async_load_fail, name);
+    }
+
+    //
+    // Cached command lists bound the error resources in place of this resource, or rasterised
+    // its old data.
+    //
+    ++resourceGeneration;
+    return true;
+  };
+
+  loads.erase(std::remove_if(loads.begin(), loads.end(), isPublished), loads.end());
 }
 
-void clearWindowColor(Color4f color)
+static void publishAsyncLoads()
 {
-  glClearColor(color._r, color._g, color._b, color._a); 
-  glClear(GL_COLOR_BUFFER_BIT);
+  publishAsyncLoads(spritesheetLoads, spritesheets, spritesheetKeys, &SpritesheetResource::_sheet);
+  publishAsyncLoads(fontLoads, fonts, fontKeys, &FontResource::_font);
+
+  if(spritesheetLoads.empty() && fontLoads.empty()){
+    asyncLoadsStarted = 0;
+    asyncLoadsCompleted = 0;
+  }
 }
 
-void clearScreenTransparent(int screenid)
+int getAsyncLoadCount()
 {
-  assert(0 <= screenid && screenid < screens.size());
-  memset(screens[screenid]._pxColors, ALPHA_KEY, screens[screenid]._pxCount * sizeof(Color4u));
+  return spritesheetLoads.size() + fontLoads.size();
 }
 
-void clearScreenShade(int shade, int screenid)
+float getAsyncLoadProgress()
 {
-  assert(0 <= screenid && screenid < screens.size());
-  shade = std::max(0, std::min(shade, 255));
-  memset(screens[screenid]._pxColors, shade, screens[screenid]._pxCount * sizeof(Color4u));
+  if(asyncLoadsStarted == 0)
+    return 1.f;
+  return static_cast<float>(asyncLoadsCompleted) / asyncLoadsStarted;
 }
 
-void clearScreenColor(Color4u color, int screenid)
+bool isSpritesheetLoading(ResourceKey_t sheetKey)
 {
-  assert(0 <= screenid && screenid < screens.size());
-  Screen& screen = screens[screenid];
-  for(int px = 0; px < screen._pxCount; ++px)
-    screen._pxColors[px] = color;
+  return spritesheets[sheetKey]._state == LoadState::LOADING;
 }
 
-void drawSprite(Vector2i position, ResourceKey_t sheetKey, int spriteid, int screenid, 
-                bool mirrorX, bool mirrorY)
+bool isFontLoading(ResourceKey_t fontKey)
 {
-  assert(0 <= screenid && screenid < screens.size());
-  auto& screen = screens[screenid];
-
-  auto search = spritesheets.find(sheetKey);
-  if(search == spritesheets.end()){
-    assert(0);
-  }
-  const auto& sheet = search->second._sheet;
-  const Color4u* const * sheetPxs = sheet._image.getPixels();
-
-  assert(0 <= spriteid);
-
-  if(sheetKey == errorSpritesheetKey)
-    spriteid = (spriteid < sheet._sprites.size()) ? spriteid : 0;
-  else
-    assert(spriteid < sheet._sprites.size());
-
-  auto& sprite = sheet._sprites[spriteid];
-
-  int screenRow {0}, screenCol{0}, screenRowOffset{0}, screenRowBase{0}, screenColBase{0},
-      spriteRowOffset{0}, spriteColOffset{0}, spriteRowMax{0}, spriteColMax{0};
-  screenRowBase = position._y - sprite._origin._y;
-  screenColBase = position._x - sprite._origin._x;
-  spriteRowMax = sprite._size._y - 1;
-  spriteColMax = sprite._size._x - 1;
-  for(int spriteRow = 0; spriteRow <= spriteRowMax; ++spriteRow){
-    screenRow = screenRowBase + spriteRow;
-    if(screenRow < 0) continue;
-    if(screenRow >= screen._resolution._y) break;
-    screenRowOffset = screenRow * screen._resolution._x;
-    spriteRowOffset = sprite._position._y + (mirrorY ? spriteRowMax - spriteRow : spriteRow); 
-    for(int spriteCol = 0; spriteCol <= spriteColMax; ++spriteCol){
-      screenCol = screenColBase + spriteCol;
-      if(screenCol < 0) continue;
-      if(screenCol >= screen._resolution._x) break;
-      spriteColOffset = sprite._position._x + (mirrorX ? spriteColMax - spriteCol : spriteCol); 
-      const Color4u& color = sheetPxs[spriteRowOffset][spriteColOffset];
-      if(color._a == ALPHA_KEY) continue;
-      screen._pxColors[screenCol + screenRowOffset] =
-        (screen._xmode == PixelMode::SHADER) ? screen._pxShader(color, screenCol, screenRow) : color;
-    }
-  }
+  return fonts[fontKey]._state == LoadState::LOADING;
 }
 
-void drawSpriteColumn(Vector2i position, ResourceKey_t sheetKey, int spriteid, int colid, int screenid)
+//
+// A skyline is the upper outline of the rects packed into a page so far, stored as horizontal
+// segments ordered by x which together span the page width. Rects are placed on top of the 
+// skyline, never beneath it; the space wasted beneath overhangs is the cost of the simplicity.
+//
+struct SkylineSegment
 {
-  assert(0 <= screenid && screenid < screens.size());
-  auto& screen = screens[screenid];
-
-  auto search = spritesheets.find(sheetKey);
-  assert(search != spritesheets.end());
-  const auto& sheet = search->second._sheet;
-  const Color4u* const * sheetPxs = sheet._image.getPixels();
-
-  assert(0 <= spriteid);
-  spriteid = spriteid < sheet._sprites.size() ? spriteid : 0; // may be an error sheet with 1 sprite.
-  auto& sprite = sheet._sprites[spriteid];
-
-  colid = std::clamp(colid, 0, sprite._size._x);
-
-  int screenRow {0}, screenCol{0}, screenRowOffset{0}, sheetCol{0};
+  int _x;
+  int _y;
+  int _width;
+};
 
-  screenCol = position._x + colid;
-  sheetCol = sprite._position._x + colid;
+//
+// Finds the position at which a rect placed on the skyline has the lowest top edge, breaking 
+// ties by the narrowest segment (best fit). Returns the index of the segment the rect's left edge
+// is placed on, or -1 if the rect fits nowhere.
+//
+static int findSkylinePosition(const std::vector<SkylineSegment>& skyline, Vector2i size,
+                               Vector2i pageSize, Vector2i& position)
+{
+  int bestIndex {-1};
+  int bestTop {std::numeric_limits<int>::max()};
+  int bestWidth {std::numeric_limits<int>::max()};
+
+  for(int i = 0; i < static_cast<int>(skyline.size()); ++i){
+    int x = skyline[i]._x;
+    if(x + size._x > pageSize._x)
+      break;
+
+    // the rect rests on the highest segment beneath it.
+    int y {0};
+    int widthLeft = size._x;
+    for(int j = i; widthLeft > 0; ++j){
+      y = std::max(y, skyline[j]._y);
+      widthLeft -= skyline[j]._width;
+    }
 
-  if(screenCol < 0 || screenCol >= screen._resolution._x) 
-    return;
+    int top = y + size._y;
+    if(top > pageSize._y)
+      continue;
 
-  for(int spriteRow = 0; spriteRow < sprite._size._y; ++spriteRow){
-    screenRow = position._y + spriteRow;
-    if(screenRow < 0) continue;
-    if(screenRow >= screen._resolution._y) break;
-    screenRowOffset = screenRow * screen._resolution._x;
-    const Color4u& color = sheetPxs[sprite._position._y + spriteRow][sheetCol];
-    if(color._a == ALPHA_KEY) continue;
-    screen._pxColors[screenCol + screenRowOffset] =
-      (screen._xmode == PixelMode::SHADER) ? screen._pxShader(color, screenCol, screenRow) : color;
+    if(top < bestTop || (top == bestTop && skyline[i]._width < bestWidth)){
+      bestIndex = i;
+      bestTop = top;
+      bestWidth = skyline[i]._width;
+      position = Vector2i{x, y};
+    }
   }
+
+  return bestIndex;
 }
 
-void drawText(Vector2i position, const std::string& text, ResourceKey_t fontKey, Color4u color, int screenid)
+static void addSkylineRect(std::vector<SkylineSegment>& skyline, int index, Vector2i position, 
+                           Vector2i size)
 {
-  assert(0 <= screenid && screenid < screens.size());
-  auto& screen = screens[screenid];
+  skyline.insert(skyline.begin() + index, SkylineSegment{position._x, position._y + size._y, size._x});
 
-  auto search = fonts.find(fontKey);
-  assert(search != fonts.end());
-  auto& font = search->second._font;
-  const Color4u* const* fontPxs = font._image.getPixels();
+  //
+  // Trim the segments now beneath the rect.
+  //
+  for(int i = index + 1; i < static_cast<int>(skyline.size());){
+    int overlap = (skyline[i - 1]._x + skyline[i - 1]._width) - skyline[i]._x;
+    if(overlap <= 0)
+      break;
+    skyline[i]._x += overlap;
+    skyline[i]._width -= overlap;
+    if(skyline[i]._width > 0)
+      break;
+    skyline.erase(skyline.begin() + i);
+  }
 
-  int baseLineY = position._y + font._baseLine;
-  for(char c : text){
-    if(c == '\n') continue;
-    assert(' ' <= c && c <= '~');
-    const Glyph& glyph = font._glyphs[static_cast<int>(c - ' ')];
-    int screenRow{0}, screenCol{0}, screenRowBase{0}, screenRowOffset {0};
-    screenRowBase = baseLineY + glyph._yoffset;
-    for(int glyphRow = 0; glyphRow < glyph._height; ++glyphRow){
-      screenRow = screenRowBase + glyphRow;
-      if(screenRow < 0) continue;
-      if(screenRow >= screen._resolution._y) break;
-      screenRowOffset = screenRow * screen._resolution._x;
-      for(int glyphCol = 0; glyphCol < glyph._width; ++glyphCol){
-        screenCol = position._x + glyphCol + glyph._xoffset;
-        if(screenCol < 0) continue;
-        if(screenCol >= screen._resolution._x) return;
-        const Color4u& pxcolor = fontPxs[glyph._y + glyphRow][glyph._x + glyphCol];
-        if(pxcolor._a == ALPHA_KEY) continue;
-        screen._pxColors[screenCol + screenRowOffset] =
-          (screen._xmode == PixelMode::SHADER) ? screen._pxShader(color, screenCol, screenRow) : color;
-      }
+  for(int i = 0; i + 1 < static_cast<int>(skyline.size());){
+    if(skyline[i]._y == skyline[i + 1]._y){
+      skyline[i]._width += skyline[i + 1]._width;
+      skyline.erase(skyline.begin() + i + 1);
     }
-    position._x += glyph._xadvance + font._glyphSpace;
+    else
+      ++i;
   }
 }
 
-void drawBorderRectangle(iRect rect, Color4u color, int screenid)
+//
+// The position of a sprite in the atlas page being packed.
+//
+struct AtlasPlacement
 {
-  assert(0 <= screenid && screenid < screens.size());
-  auto& screen = screens[screenid];
-
-  int xmin = std::clamp(rect._x,           0, screen._resolution._x - 1);
-  int xmax = std::clamp(rect._x + rect._w, 0, screen._resolution._x - 1);
-  int ymin = std::clamp(rect._y,           0, screen._resolution._y - 1);
-  int ymax = std::clamp(rect._y + rect._h, 0, screen._resolution._y - 1);
+  int _sheet;
+  int _sprite;
+  Vector2i _position;
+};
 
-  for(int x = xmin; x <= xmax; ++x){
-    screen._pxColors[x + (ymin * screen._resolution._x)] = 
-      (screen._xmode == PixelMode::SHADER) ? screen._pxShader(color, x, ymin) : color;
-    screen._pxColors[x + (ymax * screen._resolution._x)] = 
-      (screen._xmode == PixelMode::SHADER) ? screen._pxShader(color, x, ymax) : color;
+//
+// Copies the placed sprites of the sheets into a new page then points the sheets at the page.
+// The page is trimmed to the height of the skyline.
+//
+static void buildAtlasPage(const std::vector<SpritesheetResource*>& sheets,
+                           const std::vector<int>& pageSheets,
+                           const std::vector<AtlasPlacement>& placements,
+                           const std::vector<SkylineSegment>& skyline,
+                           int pageWidth, AtlasStats& stats)
+{
+  int pageHeight {0};
+  for(const auto& segment : skyline)
+    pageHeight = std::max(pageHeight, segment._y);
+
+  int pageIndex {0};
+  while(pageIndex < static_cast<int>(atlasPages.size()) && atlasPages[pageIndex]._sheetCount > 0)
+    ++pageIndex;
+  if(pageIndex == static_cast<int>(atlasPages.size()))
+    atlasPages.emplace_back();
+
+  AtlasPage& page = atlasPages[pageIndex];
+  page._image.create(Vector2i{pageWidth, pageHeight}, Color4u{ALPHA_KEY, ALPHA_KEY, ALPHA_KEY, ALPHA_KEY});
+  page._sheetCount = pageSheets.size();
+
+  for(const auto& placement : placements){
+    const Spritesheet& sheet = sheets[placement._sheet]->_sheet;
+    const Sprite& sprite = sheet._sprites[placement._sprite];
+    for(int row = 0; row < sprite._size._y; ++row){
+      memcpy(static_cast<void*>(page._image.getRow(placement._position._y + row) + placement._position._x),
+             static_cast<const void*>(sheet._image.getRow(sprite._position._y + row) + sprite._position._x),
+             sprite._size._x * sizeof(Color4u));
+    }
   }
 
-  for(int y = ymin; y <= ymax; ++y){
-    screen._pxColors[xmin + (y * screen._resolution._x)] = 
-      (screen._xmode == PixelMode::SHADER) ? screen._pxShader(color, xmin, y) : color;
-    screen._pxColors[xmax + (y * screen._resolution._x)] = 
-      (screen._xmode == PixelMode::SHADER) ? screen._pxShader(color, xmax, y) : color;
+  //
+  // The sheets' old images are only released once all sprites have been copied since sheets 
+  // may share (be views into) the same old page.
+  //
+  for(const auto& placement : placements){
+    Sprite& sprite = sheets[placement._sheet]->_sheet._sprites[placement._sprite];
+    sprite._position = placement._position;
   }
-}
 
-void drawFillRectangle(iRect rect, Color4u color, int screenid)
-{
-  assert(0 <= screenid && screenid < screens.size());
-  auto& screen = screens[screenid];
+  for(int s : pageSheets){
+    SpritesheetResource& resource = *sheets[s];
+    if(!resource._sheet._image.isView())
+      stats._bytesBefore += resource._sheet._image.getStride() * resource._sheet._image.getHeight() * sizeof(Color4u);
+    releaseAtlasPage(resource);
+    resource._sheet._image.view(page._image.getRow(0), page._image.getSize(), page._image.getStride());
+    resource._atlasPage = pageIndex;
+    encodeSpriteRuns(resource._sheet);
+  }
 
-  int xmin = std::clamp(rect._x,           0, screen._resolution._x - 1);
-  int xmax = std::clamp(rect._x + rect._w, 0, screen._resolution._x - 1);
-  int ymin = std::clamp(rect._y,           0, screen._resolution._y - 1);
-  int ymax = std::clamp(rect._y + rect._h, 0, screen._resolution._y - 1);
+  for(const auto& placement : placements){
+    const Sprite& sprite = sheets[placement._sheet]->_sheet._sprites[placement._sprite];
+    stats._occupancy += sprite._size._x * sprite._size._y;
+  }
 
-  for(int x = xmin; x <= xmax; ++x)
-    for(int y = ymin; y <= ymax; ++y)
-      screen._pxColors[x + (y * screen._resolution._x)] = 
-        (screen._xmode == PixelMode::SHADER) ? screen._pxShader(color, x, ymin) : color;
+  stats._bytesAfter += page._image.getStride() * page._image.getHeight() * sizeof(Color4u);
+  stats._sheetCount += pageSheets.size();
+  stats._pageCount++;
 }
 
-void drawLine(Vector2i p0, Vector2i p1, Color4u color, int screenid)
+AtlasStats packSpritesheets(const std::vector<ResourceKey_t>& sheetKeys)
 {
-  assert(0 <= screenid && screenid < screens.size());
-  auto& screen = screens[screenid];
+  AtlasStats stats {};
 
-  p0._x = std::clamp(p0._x, 0, screen._resolution._x - 1);
-  p1._x = std::clamp(p1._x, 0, screen._resolution._x - 1);
-  p0._y = std::clamp(p0._y, 0, screen._resolution._y - 1);
-  p1._y = std::clamp(p1._y, 0, screen._resolution._y - 1);
+  flushRecordedCommands();
 
-  //
-  // constants in line equation y=mx+c
-  //
-  int dx = static_cast<float>(p1._x - p0._x);
-  int dy = static_cast<float>(p1._y - p0._y);
+  std::vector<SpritesheetResource*> sheets {};
+  long spriteArea {0};
+  int widestSprite {0};
+  for(ResourceKey_t key : sheetKeys){
+    SpritesheetResource* resource = spritesheets.find(key);
+    if(resource == nullptr || key == errorSpritesheetKey || resource->_state != LoadState::LOADED)
+      continue;
+    if(std::find(sheets.begin(), sheets.end(), resource) != sheets.end())
+      continue;
 
-  if(dx == 0 && dy == 0)
-    return;
+    if(resource->_sheet._sprites.empty())
+      continue;
 
-  int ymin, ymax;
-  if(p0._y < p1._y){
-    ymin = p0._y;
-    ymax = p1._y;
-  }
-  else{
-    ymin = p1._y;
-    ymax = p0._y;
-  }
+    bool isPackable {true};
+    for(const auto& sprite : resource->_sheet._sprites)
+      if(sprite._size._x > ATLAS_PAGE_MAX_SIZE || sprite._size._y > ATLAS_PAGE_MAX_SIZE)
+        isPackable = false;
+    if(!isPackable){
+      log::log(log::WARN, log::msg_gfx_atlas_skipped_sheet, name::getString(resource->_nameid));
+      continue;
+    }
 
-  int xmin, xmax;
-  if(p0._x < p1._x){
-    xmin = p0._x;
-    xmax = p1._x;
-  }
-  else{
-    xmin = p1._x;
-    xmax = p0._x;
+    for(const auto& sprite : resource->_sheet._sprites){
+      spriteArea += sprite._size._x * sprite._size._y;
+      widestSprite = std::max(widestSprite, sprite._size._x);
+    }
+    sheets.push_back(resource);
   }
 
-  if(dx == 0)
-    for(int y = ymin; y < ymax; ++y)
-      screen._pxColors[xmin + (y * screen._resolution._x)] = 
-        (screen._xmode == PixelMode::SHADER) ? screen._pxShader(color, xmin, y) : color;
+  if(sheets.empty())
+    return stats;
 
-  else if(dy == 0)
-    for(int x = xmin; x < xmax; ++x)
-      screen._pxColors[x + (ymin * screen._resolution._x)] = 
-        (screen._xmode == PixelMode::SHADER) ? screen._pxShader(color, x, ymin) : color;
+  //
+  // Pages are square-ish powers of two wide; trimming the page height after packing then keeps
+  // the waste at the top of the last page small.
+  //
+  int pageWidth {1};
+  while(pageWidth < ATLAS_PAGE_MAX_SIZE && 
+        (pageWidth < widestSprite || static_cast<long>(pageWidth) * pageWidth < spriteArea))
+    pageWidth *= 2;
+  Vector2i pageSize {pageWidth, ATLAS_PAGE_MAX_SIZE};
 
-  else{
-    float m = static_cast<float>(dy) / dx;
-    for(int x = xmin; x <= xmax; ++x){
-      int y = (m * x) + ymin;
-      screen._pxColors[x + (y * screen._resolution._x)] = 
-        (screen._xmode == PixelMode::SHADER) ? screen._pxShader(color, x, y) : color;
+  std::vector<SkylineSegment> skyline {{0, 0, pageWidth}};
+  std::vector<AtlasPlacement> placements {};
+  std::vector<int> pageSheets {};
+
+  //
+  // Places all sprites of a sheet on the current page, tallest first, or none of them.
+  //
+  auto placeSheet = [&](int s){
+    std::vector<SkylineSegment> oldSkyline {skyline};
+    std::size_t oldPlacementCount = placements.size();
+
+    const auto& sprites = sheets[s]->_sheet._sprites;
+    std::vector<int> order(sprites.size());
+    for(int i = 0; i < static_cast<int>(order.size()); ++i)
+      order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&sprites](int a, int b){
+      return sprites[a]._size._y > sprites[b]._size._y;
+    });
+
+    for(int i : order){
+      Vector2i position {};
+      int index = findSkylinePosition(skyline, sprites[i]._size, pageSize, position);
+      if(index == -1){
+        skyline = std::move(oldSkyline);
+        placements.resize(oldPlacementCount);
+        return false;
+      }
+      addSkylineRect(skyline, index, position, sprites[i]._size);
+      placements.push_back(AtlasPlacement{s, i, position});
     }
+    pageSheets.push_back(s);
+    return true;
+  };
+
+  auto finishPage = [&](){
+    if(!pageSheets.empty())
+      buildAtlasPage(sheets, pageSheets, placements, skyline, pageWidth, stats);
+    skyline = {{0, 0, pageWidth}};
+    placements.clear();
+    pageSheets.clear();
+  };
+
+  //
+  // Sheets are packed in the order given so the sprites of sheets used together share pages.
+  //
+  for(int s = 0; s < static_cast<int>(sheets.size()); ++s){
+    if(placeSheet(s))
+      continue;
+    finishPage();
+    if(!placeSheet(s))
+      log::log(log::WARN, log::msg_gfx_atlas_skipped_sheet, name::getString(sheets[s]->_nameid));
   }
-}
+  finishPage();
 
-void drawPoint(Vector2i position, Color4u color, int screenid)
-{
-  assert(0 <= screenid && screenid < screens.size());
-  auto& screen = screens[screenid];
+  long pagePixels = stats._bytesAfter / sizeof(Color4u);
+  stats._occupancy = (pagePixels > 0) ? stats._occupancy / pagePixels : 0.f;
 
-  int x{position._x}, y{position._y};
+  //
+  // Cached command lists hold pointers into the old images.
+  //
+  ++resourceGeneration;
 
-  if(x < 0 || x >= screen._resolution._x)
-    return;
+  std::stringstream ss {};
+  ss << std::setprecision(3)
+     << "sheets=" << stats._sheetCount
+     << " pages=" << stats._pageCount
+     << " occupancy=" << (stats._occupancy * 100.f) << "%"
+     << " bytes before=" << stats._bytesBefore
+     << " after=" << stats._bytesAfter;
+  log::log(log::INFO, log::msg_gfx_atlas_packed, ss.str());
+
+  return stats;
+}
 
-  if(y < 0 || y >= screen._resolution._y)
+void unloadFont(ResourceKey_t fontKey)
+{
+  FontResource* resource = fonts.find(fontKey);
+  if(resource == nullptr){
+    log::log(log::WARN, log::msg_gfx_unloading_nonexistent_resource, "font" + std::to_string(fontKey));
     return;
+  }
 
-  screen._pxColors[x + (y * screen._resolution._x)] =
-        (screen._xmode == PixelMode::SHADER) ? screen._pxShader(color, x, y) : color;
+  resource->_referenceCount--;
+  if(resource->_referenceCount <= 0 && fontKey != errorFontKey){
+    flushRecordedCommands();
+    log::log(log::INFO, log::msg_gfx_unload_font_success, "key=" + std::to_string(fontKey));
+    if(fontKeys.find(resource->_nameid) == fontKey)   // failed loads are unmapped.
+      fontKeys.erase(resource->_nameid);
+    fonts.erase(fontKey);
+    ++resourceGeneration;
+  }
 }
 
-void present()
+bool reloadFont(ResourceName_t name)
 {
-  for(auto& screen : screens){
-    if(!screen._isEnabled) 
-      continue;
+  name::NameID_t nameid = name::find(name);
+  ResourceKey_t loadedKey = fontKeys.find(nameid);
+  if(loadedKey == fontKeys.nullKey)
+    return false;
 
-    glVertexPointer(2, GL_INT, 0, screen._pxPositions);
-    glColorPointer(4, GL_UNSIGNED_BYTE, 0, screen._pxColors);
-    glPointSize(screen._pxSize);
-    glDrawArrays(GL_POINTS, 0, screen._pxCount);
-  }
+  log::log(log::INFO, log::msg_gfx_reloading_font, name);
+
+  fontLoads.push_back(std::make_unique<AsyncLoad<Font>>());
+  AsyncLoad<Font>* load = fontLoads.back().get();
+  load->_key = loadedKey;
+  load->_sequence = ++asyncLoadSequence;
+  load->_isReload = true;
+  ++asyncLoadsStarted;
 
-  SDL_GL_SwapWindow(window);
+  worker::submit([load, filename = std::string{name}](){
+    load->_isRead = readFont(filename.c_str(), load->_data);
+    load->_isDone.store(true, std::memory_order_release);
+  });
+
+  return true;
 }
 
-void setScreenPixelMode(PixelMode mode, int screenid)
+const Font* getFont(ResourceKey_t fontKey)
 {
-  assert(0 <= screenid && screenid < screens.size());
-  screens[screenid]._xmode = mode;
+  if(!fonts.isValid(fontKey)){
+    log::log(log::WARN, log::msg_gfx_unloading_nonexistent_resource, "font" + std::to_string(fontKey));
+    return nullptr;
+  }
+  return &(resolveFont(fontKey)._font);
 }
 
-void setScreenSizeMode(SizeMode mode, int screenid)
+int getSpriteCount(ResourceKey_t sheetKey)
 {
-  assert(0 <= screenid && screenid < screens.size());
-  auto& screen = screens[screenid];
-  screen._smode = mode;
-  autoAdjustScreen(windowSize, screen);
+  return resolveSpritesheet(sheetKey)._sheet._sprites.size();
 }
 
-void setScreenPositionMode(PositionMode mode, int screenid)
+bool setVsync(bool isEnabled)
 {
-  assert(0 <= screenid && screenid < screens.size());
-  auto& screen = screens[screenid];
-  screen._pmode = mode;
-  autoAdjustScreen(windowSize, screen);
+  if(isHeadlessMode)
+    return false;
+
+  if(SDL_GL_SetSwapInterval(isEnabled ? 1 : 0) < 0){
+    if(isEnabled)
+      log::log(log::WARN, log::msg_gfx_fail_vsync, std::string{SDL_GetError()});
+    return false;
+  }
+
+  if(isEnabled)
+    log::log(log::INFO, log::msg_gfx_vsync);
+  return isEnabled;
 }
 
-void setScreenManualPosition(Vector2i position, int screenid)
+void onWindowResize(Vector2i windowSize)
 {
-  assert(0 <= screenid && screenid < screens.size());
-  auto& screen = screens[screenid];
-  screen._manualPosition = position;
-  if(screen._pmode == PositionMode::MANUAL)
+  setViewport(iRect{0, 0, windowSize._x, windowSize._y});
+  for(auto& screen : screens)
     autoAdjustScreen(windowSize, screen);
 }
 
-void setScreenManualPixelSize(int pxSize, int screenid)
+void clearWindowColor(Color4f color)
+{
+  if(isHeadlessMode)
+    return;
+  glClearColor(color._r, color._g, color._b, color._a); 
+  glClear(GL_COLOR_BUFFER_BIT);
+}
+
+//
+// Row blitters used to copy rows of sprite pixels to screen rows for sheets drawn with keyed 
+// blits; see Spritesheet. All pixels with alpha == ALPHA_KEY are skipped. Rows are processed in
+// blocks of 8 (AVX2) or 4 (SSE2) pixels where the alpha byte of each source pixel is compared 
+// against the key and the result used to select between the source and destination pixel; a 
+// scalar loop handles the remainder.
+//
+// note: relies on sizeof(Color4u) == 4 with the alpha channel in the most significant byte.
+//
+static void blitRowKeyed(Color4u* dst, const Color4u* src, int count)
+{
+  int i {0};
+#if defined(__AVX2__)
+  const __m256i alphaMask8 = _mm256_set1_epi32(0xff000000);
+  const __m256i key8 = _mm256_set1_epi32(ALPHA_KEY << 24);
+  for(; i + 8 <= count; i += 8){
+    __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+    __m256i isKey = _mm256_cmpeq_epi32(_mm256_and_si256(s, alphaMask8), key8);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_blendv_epi8(s, d, isKey));
+  }
+#endif
+#if defined(__SSE2__)
+  const __m128i alphaMask4 = _mm_set1_epi32(0xff000000);
+  const __m128i key4 = _mm_set1_epi32(ALPHA_KEY << 24);
+  for(; i + 4 <= count; i += 4){
+    __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+    __m128i isKey = _mm_cmpeq_epi32(_mm_and_si128(s, alphaMask4), key4);
+    __m128i blend = _mm_or_si128(_mm_and_si128(isKey, d), _mm_andnot_si128(isKey, s));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), blend);
+  }
+#endif
+  for(; i < count; ++i)
+    if(src[i]._a != ALPHA_KEY)
+      dst[i] = src[i];
+}
+
+//
+// As blitRowKeyed but reads the source row backwards, i.e. dst[i] = src[-i]; used to draw 
+// sprites mirrored along the x-axis.
+//
+static void blitRowKeyedReversed(Color4u* dst, const Color4u* src, int count)
+{
+  int i {0};
+#if defined(__AVX2__)
+  const __m256i alphaMask8 = _mm256_set1_epi32(0xff000000);
+  const __m256i key8 = _mm256_set1_epi32(ALPHA_KEY << 24);
+  const __m256i reverse8 = _mm256_set_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  for(; i + 8 <= count; i += 8){
+    __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src - i - 7));
+    s = _mm256_permutevar8x32_epi32(s, reverse8);
+    __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+    __m256i isKey = _mm256_cmpeq_epi32(_mm256_and_si256(s, alphaMask8), key8);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_blendv_epi8(s, d, isKey));
+  }
+#endif
+#if defined(__SSE2__)
+  const __m128i alphaMask4 = _mm_set1_epi32(0xff000000);
+  const __m128i key4 = _mm_set1_epi32(ALPHA_KEY << 24);
+  for(; i + 4 <= count; i += 4){
+    __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src - i - 3));
+    s = _mm_shuffle_epi32(s, _MM_SHUFFLE(0, 1, 2, 3));
+    __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+    __m128i isKey = _mm_cmpeq_epi32(_mm_and_si128(s, alphaMask4), key4);
+    __m128i blend = _mm_or_si128(_mm_and_si128(isKey, d), _mm_andnot_si128(isKey, s));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), blend);
+  }
+#endif
+  for(; i < count; ++i)
+    if(src[-i]._a != ALPHA_KEY)
+      dst[i] = src[-i];
+}
+
+//
+// Copies count pixels reading the source backwards, i.e. dst[i] = src[-i]; used to draw sprite
+// runs mirrored along the x-axis. Pixels are processed in blocks of 8 (AVX2) or 4 (SSE2) with
+// a scalar loop for the remainder.
+//
+// note: relies on sizeof(Color4u) == 4.
+//
+static void copyRowReversed(Color4u* dst, const Color4u* src, int count)
+{
+  int i {0};
+#if defined(__AVX2__)
+  const __m256i reverse8 = _mm256_set_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  for(; i + 8 <= count; i += 8){
+    __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src - i - 7));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_permutevar8x32_epi32(s, reverse8));
+  }
+#endif
+#if defined(__SSE2__)
+  for(; i + 4 <= count; i += 4){
+    __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src - i - 3));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_shuffle_epi32(s, _MM_SHUFFLE(0, 1, 2, 3)));
+  }
+#endif
+  for(; i < count; ++i)
+    dst[i] = src[-i];
+}
+
+//
+// Fills count pixels with a color. The color is broadcast to a 32-bit pattern and stored in 
+// blocks of 8 (AVX2) or 4 (SSE2) pixels with a scalar loop for the remainder; std::fill_n on 
+// Color4u is not vectorised by all compilers as the color is not a scalar.
+//
+// note: relies on sizeof(Color4u) == 4.
+//
+static void fillRow(Color4u* dst, int count, Color4u color)
+{
+  uint32_t pattern;
+  memcpy(&pattern, &color, sizeof(pattern));
+  int i {0};
+#if defined(__AVX2__)
+  const __m256i pattern8 = _mm256_set1_epi32(pattern);
+  for(; i + 8 <= count; i += 8)
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), pattern8);
+#endif
+#if defined(__SSE2__)
+  const __m128i pattern4 = _mm_set1_epi32(pattern);
+  for(; i + 4 <= count; i += 4)
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), pattern4);
+#endif
+  for(; i < count; ++i)
+    dst[i] = color;
+}
+
+//
+// The target of the draw implementations: a band of rows [_rowBegin, _rowEnd) of a screen and
+// the shader to apply. Draw implementations only write to (and mark dirty) the rows in the band;
+// when drawing immediately the band is the whole screen.
+//
+struct DrawTarget
+{
+  Screen* _screen;
+  int _rowBegin;
+  int _rowEnd;
+  PXShader_t _shader;
+};
+
+//
+// Applies the target's pixel shader to a span of pixels which have just been written to the
+// screen. The span shading is resolved at compile time so draw paths instantiated for
+// PixelMode::NO_SHADER have no per-pixel (or per-span) cost.
+//
+template<PixelMode Mode>
+static inline void shadeSpan(const DrawTarget& target, Color4u* span, int count, int pxx, int pxy)
+{
+  if constexpr (Mode == PixelMode::SHADER)
+    target._shader(span, count, pxx, pxy);
+}
+
+template<PixelMode Mode>
+static inline void fillSpan(const DrawTarget& target, int x, int y, int count, Color4u color)
+{
+  Screen& screen = *target._screen;
+  Color4u* span = screen._pxColors + x + (y * screen._resolution._x);
+  fillRow(span, count, color);
+  shadeSpan<Mode>(target, span, count, x, y);
+}
+
+template<PixelMode Mode>
+static inline void writePixel(const DrawTarget& target, int x, int y, Color4u color)
+{
+  Screen& screen = *target._screen;
+  Color4u* px = screen._pxColors + x + (y * screen._resolution._x);
+  *px = color;
+  shadeSpan<Mode>(target, px, 1, x, y);
+}
+
+static void clearImpl(const DrawTarget& target, Color4u color)
+{
+  Screen& screen = *target._screen;
+  Color4u* begin = screen._pxColors + (target._rowBegin * screen._resolution._x);
+  fillRow(begin, (target._rowEnd - target._rowBegin) * screen._resolution._x, color);
+  markDirty(screen, 0, target._rowBegin, screen._resolution._x - 1, target._rowEnd - 1);
+}
+
+template<PixelMode Mode>
+static void drawSpriteImpl(const DrawTarget& target, Vector2i position, const Spritesheet& sheet, 
+                           const Sprite& sprite, bool mirrorX, bool mirrorY)
+{
+  Screen& screen = *target._screen;
+
+  int screenRowBase = position._y - sprite._origin._y;
+  int screenColBase = position._x - sprite._origin._x;
+
+  //
+  // Clip the sprite against the target once up front so the row loops need no bounds checks.
+  // Ranges are w.r.t sprite space and are half open, i.e. [start, end).
+  //
+  int spriteColStart = std::max(0, -screenColBase);
+  int spriteColEnd = std::min(sprite._size._x, screen._resolution._x - screenColBase);
+  int spriteRowStart = std::max(0, target._rowBegin - screenRowBase);
+  int spriteRowEnd = std::min(sprite._size._y, target._rowEnd - screenRowBase);
+  if(spriteColStart >= spriteColEnd || spriteRowStart >= spriteRowEnd)
+    return;
+
+  markDirty(screen, screenColBase + spriteColStart, screenRowBase + spriteRowStart, 
+            screenColBase + spriteColEnd - 1, screenRowBase + spriteRowEnd - 1);
+
+  int spriteRowMax = sprite._size._y - 1;
+  int spriteColMax = sprite._size._x - 1;
+  const Color4u* sheetPxs = sheet._image.getPixels();
+
+  //
+  // Keyed blits write only the opaque pixels of a row so cannot shade spans; shaded sprites are
+  // always drawn by runs.
+  //
+  if constexpr (Mode == PixelMode::NO_SHADER){
+    if(sheet._isKeyedBlit){
+      int count = spriteColEnd - spriteColStart;
+
+      //
+      // Sheet column of the first pixel to copy; when mirroring the row is read backwards.
+      //
+      int sheetColStart = sprite._position._x + (mirrorX ? spriteColMax - spriteColStart : spriteColStart);
+
+      for(int spriteRow = spriteRowStart; spriteRow < spriteRowEnd; ++spriteRow){
+        int screenRow = screenRowBase + spriteRow;
+        int sheetRow = sprite._position._y + (mirrorY ? spriteRowMax - spriteRow : spriteRow); 
+        const Color4u* src = sheet._image.getRow(sheetRow) + sheetColStart;
+        Color4u* dst = screen._pxColors + (screenRow * screen._resolution._x) + screenColBase + spriteColStart;
+        if(mirrorX)
+          blitRowKeyedReversed(dst, src, count);
+        else
+          blitRowKeyed(dst, src, count);
+      }
+      return;
+    }
+  }
+
+  for(int spriteRow = spriteRowStart; spriteRow < spriteRowEnd; ++spriteRow){
+    int screenRow = screenRowBase + spriteRow;
+    int runsRow = sprite._rowRunsBase + (mirrorY ? spriteRowMax - spriteRow : spriteRow);
+    Color4u* dstRow = screen._pxColors + (screenRow * screen._resolution._x) + screenColBase;
+
+    for(int r = sheet._rowRuns[runsRow]; r < sheet._rowRuns[runsRow + 1]; ++r){
+      const SpriteRun& run = sheet._runs[r];
+
+      //
+      // Columns spanned by the run w.r.t the drawn (possibly mirrored) sprite, clipped.
+      //
+      int runColStart = mirrorX ? spriteColMax - (run._start + run._length - 1) : run._start;
+      int colStart = std::max(runColStart, spriteColStart);
+      int colEnd = std::min(runColStart + run._length, spriteColEnd);
+      if(colStart >= colEnd)
+        continue;
+
+      int count = colEnd - colStart;
+      Color4u* dst = dstRow + colStart;
+
+      //
+      // When mirroring, the source pixel of drawn column c is sprite column (spriteColMax - c) 
+      // so the run is read backwards.
+      //
+      if(mirrorX){
+        const Color4u* src = sheetPxs + run._pixelOffset + (spriteColMax - colStart) - run._start;
+        copyRowReversed(dst, src, count);
+      }
+      else{
+        const Color4u* src = sheetPxs + run._pixelOffset + (colStart - run._start);
+        memcpy(static_cast<void*>(dst), static_cast<const void*>(src), count * sizeof(Color4u));
+      }
+
+      shadeSpan<Mode>(target, dst, count, screenColBase + colStart, screenRow);
+    }
+  }
+}
+
+template<PixelMode Mode>
+static void drawSpriteColumnImpl(const DrawTarget& target, Vector2i position, const Spritesheet& sheet, 
+                                 const Sprite& sprite, int colid)
+{
+  Screen& screen = *target._screen;
+
+  int screenCol = position._x + colid;
+
+  if(screenCol < 0 || screenCol >= screen._resolution._x) 
+    return;
+
+  int spriteRowStart = std::max(0, target._rowBegin - position._y);
+  int spriteRowEnd = std::min(sprite._size._y, target._rowEnd - position._y);
+  if(spriteRowStart >= spriteRowEnd)
+    return;
+
+  markDirty(screen, screenCol, position._y + spriteRowStart, screenCol, position._y + spriteRowEnd - 1);
+
+  const Color4u* sheetPxs = sheet._image.getPixels();
+
+  for(int spriteRow = spriteRowStart; spriteRow < spriteRowEnd; ++spriteRow){
+    int screenRow = position._y + spriteRow;
+
+    //
+    // Find the run (if any) containing the column; transparent pixels belong to no run.
+    //
+    int runsRow = sprite._rowRunsBase + spriteRow;
+    int r = sheet._rowRuns[runsRow];
+    int rEnd = sheet._rowRuns[runsRow + 1];
+    while(r < rEnd && sheet._runs[r]._start + sheet._runs[r]._length <= colid) ++r;
+    if(r == rEnd || sheet._runs[r]._start > colid) continue;
+
+    const Color4u& color = sheetPxs[sheet._runs[r]._pixelOffset + (colid - sheet._runs[r]._start)];
+    writePixel<Mode>(target, screenCol, screenRow, color);
+  }
+}
+
+//
+// Calls onGlyph(glyph, x, y) for each character of a text, where (x, y) is the position of the 
+// bottom-left of the glyph w.r.t the bottom-left of the text block; see TextLayout.
+//
+template<typename OnGlyph>
+static void layoutGlyphs(std::string_view text, const Font& font, OnGlyph&& onGlyph)
+{
+  int lineCount = 1 + std::count(text.begin(), text.end(), '\n');
+  int x {0};
+  int baseLineY = ((lineCount - 1) * font._lineHeight) + font._baseLine;
+  for(char c : text){
+    if(c == '\n'){
+      x = 0;
+      baseLineY -= font._lineHeight;
+      continue;
+    }
+    assert(' ' <= c && c <= '~');
+    const Glyph& glyph = font._glyphs[static_cast<int>(c - ' ')];
+    onGlyph(glyph, x + glyph._xoffset, baseLineY + glyph._yoffset);
+    x += glyph._xadvance + font._glyphSpace;
+  }
+}
+
+template<PixelMode Mode>
+static void drawTextImpl(const DrawTarget& target, Vector2i position, std::string_view text, 
+                         const Font& font, Color4u color)
+{
+  Screen& screen = *target._screen;
+
+  layoutGlyphs(text, font, [&](const Glyph& glyph, int x, int y){
+    int screenRowBase = position._y + y;
+    int screenColBase = position._x + x;
+
+    //
+    // Clip the glyph against the target; ranges are w.r.t glyph space and half open.
+    //
+    int glyphColStart = std::max(0, -screenColBase);
+    int glyphColEnd = std::min(glyph._width, screen._resolution._x - screenColBase);
+    int glyphRowStart = std::max(0, target._rowBegin - screenRowBase);
+    int glyphRowEnd = std::min(glyph._height, target._rowEnd - screenRowBase);
+    if(glyphColStart >= glyphColEnd || glyphRowStart >= glyphRowEnd)
+      return;
+
+    markDirty(screen, screenColBase + glyphColStart, screenRowBase + glyphRowStart, 
+              screenColBase + glyphColEnd - 1, screenRowBase + glyphRowEnd - 1);
+
+    //
+    // Fill each run of opaque glyph pixels in a row as a single span.
+    //
+    for(int glyphRow = glyphRowStart; glyphRow < glyphRowEnd; ++glyphRow){
+      int screenRow = screenRowBase + glyphRow;
+      const Color4u* glyphPxs = font._image.getRow(glyph._y + glyphRow) + glyph._x;
+      int glyphCol {glyphColStart};
+      while(glyphCol < glyphColEnd){
+        while(glyphCol < glyphColEnd && glyphPxs[glyphCol]._a == ALPHA_KEY) ++glyphCol;
+        int spanStart = glyphCol;
+        while(glyphCol < glyphColEnd && glyphPxs[glyphCol]._a != ALPHA_KEY) ++glyphCol;
+        if(glyphCol > spanStart)
+          fillSpan<Mode>(target, screenColBase + spanStart, screenRow, glyphCol - spanStart, color);
+      }
+    }
+  });
+}
+
+//
+// Draws text with a tinted font (see TintedFont) by drawing each glyph as a sprite.
+//
+template<PixelMode Mode>
+static void drawTintedTextImpl(const DrawTarget& target, Vector2i position, std::string_view text, 
+                               const Font& font, const Spritesheet& tintedSheet)
+{
+  layoutGlyphs(text, font, [&](const Glyph& glyph, int x, int y){
+    const Sprite& sprite = tintedSheet._sprites[&glyph - font._glyphs.data()];
+    drawSpriteImpl<Mode>(target, Vector2i{position._x + x, position._y + y}, tintedSheet, sprite, false, false);
+  });
+}
+
+//
+// Fills spans (in any order) offset by position, clipped to the target; the primitive filled 
+// shapes are drawn with. Does not mark the screen dirty as callers know the bounds of their 
+// shapes and can mark them in one go.
+//
+template<PixelMode Mode>
+static void fillSpansImpl(const DrawTarget& target, Vector2i position, const Span* spans, int count,
+                          Color4u color)
+{
+  int screenWidth = target._screen->_resolution._x;
+  for(int i = 0; i < count; ++i){
+    const Span& span = spans[i];
+    int screenRow = position._y + span._y;
+    if(screenRow < target._rowBegin || screenRow >= target._rowEnd)
+      continue;
+    int colStart = std::max(position._x + span._x, 0);
+    int colEnd = std::min(position._x + span._x + span._length, screenWidth);
+    if(colStart < colEnd)
+      fillSpan<Mode>(target, colStart, screenRow, colEnd - colStart, color);
+  }
+}
+
+template<PixelMode Mode>
+static void drawTextLayoutImpl(const DrawTarget& target, Vector2i position, const TextLayout& layout, 
+                               Color4u color)
+{
+  Screen& screen = *target._screen;
+
+  iRect bounds = layout.getBounds();
+  int rowStart = std::max(position._y + bounds._y, target._rowBegin);
+  int rowEnd = std::min(position._y + bounds._y + bounds._h, target._rowEnd);
+  if(rowStart >= rowEnd)
+    return;
+
+  markDirty(screen, position._x + bounds._x, rowStart, position._x + bounds._x + bounds._w - 1, rowEnd - 1);
+
+  const std::vector<Span>& spans = layout.getSpans();
+
+  //
+  // Spans are ordered by row so only those within the target need be filled.
+  //
+  auto byRow = [](const Span& s, int y){return s._y < y;};
+  auto first = std::lower_bound(spans.begin(), spans.end(), rowStart - position._y, byRow);
+  auto last = std::lower_bound(first, spans.end(), rowEnd - position._y, byRow);
+  fillSpansImpl<Mode>(target, position, spans.data() + (first - spans.begin()), last - first, color);
+}
+
+template<PixelMode Mode>
+static void drawBorderRectangleImpl(const DrawTarget& target, iRect rect, Color4u color)
+{
+  Screen& screen = *target._screen;
+
+  int xmin = std::clamp(rect._x,           0, screen._resolution._x - 1);
+  int xmax = std::clamp(rect._x + rect._w, 0, screen._resolution._x - 1);
+  int ymin = std::clamp(rect._y,           0, screen._resolution._y - 1);
+  int ymax = std::clamp(rect._y + rect._h, 0, screen._resolution._y - 1);
+
+  if(target._rowBegin <= ymin && ymin < target._rowEnd){
+    markDirty(screen, xmin, ymin, xmax, ymin);
+    fillSpan<Mode>(target, xmin, ymin, xmax - xmin + 1, color);
+  }
+
+  if(target._rowBegin <= ymax && ymax < target._rowEnd){
+    markDirty(screen, xmin, ymax, xmax, ymax);
+    fillSpan<Mode>(target, xmin, ymax, xmax - xmin + 1, color);
+  }
+
+  int yBegin = std::max(ymin, target._rowBegin);
+  int yEnd = std::min(ymax + 1, target._rowEnd);
+  if(yBegin >= yEnd)
+    return;
+
+  markDirty(screen, xmin, yBegin, xmin, yEnd - 1);
+  markDirty(screen, xmax, yBegin, xmax, yEnd - 1);
+
+  for(int y = yBegin; y < yEnd; ++y){
+    writePixel<Mode>(target, xmin, y, color);
+    writePixel<Mode>(target, xmax, y, color);
+  }
+}
+
+template<PixelMode Mode>
+static void drawFillRectangleImpl(const DrawTarget& target, iRect rect, Color4u color)
+{
+  Screen& screen = *target._screen;
+
+  int xmin = std::clamp(rect._x,           0, screen._resolution._x - 1);
+  int xmax = std::clamp(rect._x + rect._w, 0, screen._resolution._x - 1);
+  int ymin = std::clamp(rect._y,           0, screen._resolution._y - 1);
+  int ymax = std::clamp(rect._y + rect._h, 0, screen._resolution._y - 1);
+
+  ymin = std::max(ymin, target._rowBegin);
+  ymax = std::min(ymax, target._rowEnd - 1);
+  if(ymin > ymax)
+    return;
+
+  markDirty(screen, xmin, ymin, xmax, ymax);
+
+  for(int y = ymin; y <= ymax; ++y)
+    fillSpan<Mode>(target, xmin, y, xmax - xmin + 1, color);
+}
+
+//
+// Cohen-Sutherland outcodes of a point w.r.t a clip rectangle; a line can be trivially rejected 
+// if both its end points are outside the same edge.
+//
+enum OutCode : int
+{
+  OUTCODE_INSIDE = 0,
+  OUTCODE_LEFT   = 1 << 0,
+  OUTCODE_RIGHT  = 1 << 1,
+  OUTCODE_BOTTOM = 1 << 2,
+  OUTCODE_TOP    = 1 << 3
+};
+
+static int computeOutCode(Vector2i p, int xmin, int ymin, int xmax, int ymax)
+{
+  int code {OUTCODE_INSIDE};
+  if(p._x < xmin) code |= OUTCODE_LEFT;
+  else if(p._x > xmax) code |= OUTCODE_RIGHT;
+  if(p._y < ymin) code |= OUTCODE_BOTTOM;
+  else if(p._y > ymax) code |= OUTCODE_TOP;
+  return code;
+}
+
+//
+// Floor and ceiling of n / d for d > 0.
+//
+static int64_t floorDiv(int64_t n, int64_t d)
+{
+  return (n >= 0) ? n / d : -((-n + d - 1) / d);
+}
+
+static int64_t ceilDiv(int64_t n, int64_t d)
+{
+  return -floorDiv(-n, d);
+}
+
+//
+// Draws a line with an integer (Bresenham) rasteriser. Both end points are drawn.
+//
+// The line steps one pixel at a time along its major axis; at step i (0 <= i <= major length)
+// the minor axis offset is round(i * minor / major), i.e. floor((2i.minor + major) / 2major),
+// with the line drawn from its end point with the smaller major coordinate so lines are the 
+// same regardless of the order of their end points.
+//
+// Lines are clipped to the screen (and band) by first trivially rejecting them with outcodes 
+// then clipping the range of steps, rather than clipping the end points, so clipped lines are 
+// exactly the visible pixels of the unclipped line. Lines closer to horizontal are drawn as 
+// runs of pixels on each row.
+//
+template<PixelMode Mode>
+static void drawLineImpl(const DrawTarget& target, Vector2i p0, Vector2i p1, Color4u color)
+{
+  Screen& screen = *target._screen;
+
+  int xmin {0};
+  int xmax {screen._resolution._x - 1};
+  int ymin {std::max(0, target._rowBegin)};
+  int ymax {std::min(screen._resolution._y, target._rowEnd) - 1};
+  if(xmin > xmax || ymin > ymax)
+    return;
+
+  if(computeOutCode(p0, xmin, ymin, xmax, ymax) & computeOutCode(p1, xmin, ymin, xmax, ymax))
+    return;
+
+  bool isXMajor = std::abs(static_cast<int64_t>(p1._x) - p0._x) >= 
+                  std::abs(static_cast<int64_t>(p1._y) - p0._y);
+
+  //
+  // Work in major/minor axis coordinates (u, v) with u ascending.
+  //
+  if(isXMajor ? (p0._x > p1._x) : (p0._y > p1._y))
+    std::swap(p0, p1);
+
+  int64_t u0    = isXMajor ? p0._x : p0._y;
+  int64_t v0    = isXMajor ? p0._y : p0._x;
+  int64_t du    = (isXMajor ? p1._x : p1._y) - u0;
+  int64_t dv    = (isXMajor ? p1._y : p1._x) - v0;
+  int64_t sv    = (dv < 0) ? -1 : 1;
+  int64_t adv   = std::abs(dv);
+  int64_t umin  = isXMajor ? xmin : ymin;
+  int64_t umax  = isXMajor ? xmax : ymax;
+  int64_t vmin  = isXMajor ? ymin : xmin;
+  int64_t vmax  = isXMajor ? ymax : xmax;
+
+  //
+  // Clip the steps to those within the major axis range then to those whose minor offset k is
+  // within the minor axis range.
+  //
+  int64_t iBegin = std::max<int64_t>(0, umin - u0);
+  int64_t iEnd = std::min<int64_t>(du, umax - u0);
+
+  int64_t kmin = (sv > 0) ? vmin - v0 : v0 - vmax;
+  int64_t kmax = (sv > 0) ? vmax - v0 : v0 - vmin;
+  if(adv == 0){
+    if(kmin > 0 || kmax < 0)
+      return;
+  }
+  else{
+    iBegin = std::max(iBegin, ceilDiv((2 * kmin - 1) * du, 2 * adv));
+    iEnd = std::min(iEnd, floorDiv((2 * kmax + 1) * du - 1, 2 * adv));
+  }
+  if(iBegin > iEnd)
+    return;
+
+  //
+  // The numerator of the minor offset of the first step, split into offset and remainder.
+  //
+  int64_t twoDu = 2 * std::max<int64_t>(du, 1);
+  int64_t numerator = (2 * iBegin * adv) + du;
+  int64_t k = numerator / twoDu;
+  int64_t remainder = numerator % twoDu;
+
+  if(isXMajor){
+    int y = v0 + (sv * k);
+    int x = u0 + iBegin;
+    int xEnd = u0 + iEnd;
+    while(x <= xEnd){
+
+      //
+      // The last step of this row is the one before the minor offset next increments.
+      //
+      int runEnd = xEnd;
+      if(adv != 0)
+        runEnd = std::min<int64_t>(xEnd, x + ((twoDu - remainder - 1) / (2 * adv)));
+      fillSpan<Mode>(target, x, y, runEnd - x + 1, color);
+      markDirty(screen, x, y, runEnd, y);
+
+      remainder += (runEnd - x + 1) * 2 * adv;
+      x = runEnd + 1;
+      remainder -= twoDu;
+      y += sv;
+    }
+  }
+  else{
+    int x = v0 + (sv * k);
+    int yEnd = u0 + iEnd;
+    for(int y = u0 + iBegin; y <= yEnd; ++y){
+      writePixel<Mode>(target, x, y, color);
+      markDirtyPixel(screen, x, y);
+      remainder += 2 * adv;
+      if(remainder >= twoDu){
+        remainder -= twoDu;
+        x += sv;
+      }
+    }
+  }
+}
+
+template<PixelMode Mode>
+static void drawLinesImpl(const DrawTarget& target, const Vector2i* vertices, int vertexCount, Color4u color)
+{
+  for(int i = 0; i + 1 < vertexCount; i += 2)
+    drawLineImpl<Mode>(target, vertices[i], vertices[i + 1], color);
+}
+
+template<PixelMode Mode>
+static void drawPointImpl(const DrawTarget& target, Vector2i position, Color4u color)
+{
+  Screen& screen = *target._screen;
+
+  int x{position._x}, y{position._y};
+
+  if(x < 0 || x >= screen._resolution._x)
+    return;
+
+  if(y < target._rowBegin || y >= target._rowEnd)
+    return;
+
+  writePixel<Mode>(target, x, y, color);
+  markDirtyPixel(screen, x, y);
+}
+
+template<PixelMode Mode>
+static void executeCommandImpl(const DrawTarget& target, const DrawCommand& command, const char* text,
+                               const Vector2i* vertices)
+{
+  switch(command._type){
+    case DrawCommand::Type::CLEAR:
+      clearImpl(target, command._color);
+      break;
+    case DrawCommand::Type::SPRITE:
+      drawSpriteImpl<Mode>(target, command._p0, *command._sheet, *command._sprite, 
+                           command._mirrorX, command._mirrorY);
+      break;
+    case DrawCommand::Type::SPRITE_COLUMN:
+      drawSpriteColumnImpl<Mode>(target, command._p0, *command._sheet, *command._sprite, command._colid);
+      break;
+    case DrawCommand::Type::TEXT:
+    {
+      std::string_view commandText {text + command._textOffset, static_cast<std::size_t>(command._textLength)};
+      if(command._sheet != nullptr)
+        drawTintedTextImpl<Mode>(target, command._p0, commandText, *command._font, *command._sheet);
+      else
+        drawTextImpl<Mode>(target, command._p0, commandText, *command._font, command._color);
+      break;
+    }
+    case DrawCommand::Type::TEXT_LAYOUT:
+      drawTextLayoutImpl<Mode>(target, command._p0, *command._layout, command._color);
+      break;
+    case DrawCommand::Type::BORDER_RECTANGLE:
+      drawBorderRectangleImpl<Mode>(target, command._rect, command._color);
+      break;
+    case DrawCommand::Type::FILL_RECTANGLE:
+      drawFillRectangleImpl<Mode>(target, command._rect, command._color);
+      break;
+    case DrawCommand::Type::LINE:
+      drawLineImpl<Mode>(target, command._p0, command._p1, command._color);
+      break;
+    case DrawCommand::Type::LINES:
+      drawLinesImpl<Mode>(target, vertices + command._vertexOffset, command._vertexCount, command._color);
+      break;
+    case DrawCommand::Type::POINT:
+      drawPointImpl<Mode>(target, command._p0, command._color);
+      break;
+  }
+}
+
+//
+// Executes a command clipped to the band of the target. Text commands read their text from
+// the text argument at the command's text offset, and line list commands their vertices from 
+// the vertices argument at the command's vertex offset.
+//
+static void executeCommand(const DrawTarget& target, const DrawCommand& command, const char* text,
+                           const Vector2i* vertices)
+{
+  DrawTarget commandTarget {target};
+  commandTarget._shader = command._shader;
+  if(command._xmode == PixelMode::SHADER)
+    executeCommandImpl<PixelMode::SHADER>(commandTarget, command, text, vertices);
+  else
+    executeCommandImpl<PixelMode::NO_SHADER>(commandTarget, command, text, vertices);
+}
+
+//
+// Either executes a command immediately on the whole screen or, in command buffer mode, records
+// the command (and any text or vertices it draws) for execution in 'flushCommands'.
+//
+static void submitCommand(Screen& screen, DrawCommand& command, std::string_view text = {},
+                          const std::vector<Vector2i>& vertices = {})
+{
+  command._xmode = screen._xmode;
+  command._shader = screen._pxShader;
+  command._textLength = text.size();
+  command._vertexCount = vertices.size();
+
+  if(isCommandBufferEnabled){
+    command._textOffset = screen._commandText.size();
+    screen._commandText.append(text);
+    command._vertexOffset = screen._commandVertices.size();
+    screen._commandVertices.insert(screen._commandVertices.end(), vertices.begin(), vertices.end());
+    screen._commands.push_back(command);
+    return;
+  }
+
+  command._textOffset = 0;
+  command._vertexOffset = 0;
+  executeCommand(DrawTarget{&screen, 0, screen._resolution._y, nullptr}, command, text.data(), 
+                 vertices.data());
+}
+
+//
+// Binds the resources drawn by a sprite, sprite column or text command from the command's 
+// resource key (and sprite id). Keys of resources which are not loaded bind the error resources
+// and out of range sprite ids bind sprite 0.
+//
+static void bindCommandResources(DrawCommand& command)
+{
+  switch(command._type){
+    case DrawCommand::Type::SPRITE:
+    case DrawCommand::Type::SPRITE_COLUMN:
+    {
+      const SpritesheetResource* resource = spritesheets.find(command._resourceKey);
+      if(resource == nullptr || resource->_state != LoadState::LOADED)
+        resource = &spritesheets[errorSpritesheetKey];
+      const auto& sheet = resource->_sheet;
+      int spriteid = (command._spriteid < sheet._sprites.size()) ? command._spriteid : 0;
+      command._sheet = &sheet;
+      command._sprite = &sheet._sprites[spriteid];
+      if(command._type == DrawCommand::Type::SPRITE_COLUMN)
+        command._colid = std::clamp(command._colid, 0, command._sprite->_size._x);
+      break;
+    }
+    case DrawCommand::Type::TEXT:
+    {
+      const FontResource* resource = fonts.find(command._resourceKey);
+      if(resource == nullptr || resource->_state != LoadState::LOADED)
+        resource = &fonts[errorFontKey];
+      command._font = &resource->_font;
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+void clearScreenTransparent(int screenid)
+{
+  assert(0 <= screenid && screenid < screens.size());
+  DrawCommand command {};
+  command._type = DrawCommand::Type::CLEAR;
+  command._color = Color4u{ALPHA_KEY, ALPHA_KEY, ALPHA_KEY, ALPHA_KEY};
+  submitCommand(screens[screenid], command);
+}
+
+void clearScreenShade(int shade, int screenid)
+{
+  assert(0 <= screenid && screenid < screens.size());
+  uint8_t s = std::max(0, std::min(shade, 255));
+  DrawCommand command {};
+  command._type = DrawCommand::Type::CLEAR;
+  command._color = Color4u{s, s, s, s};
+  submitCommand(screens[screenid], command);
+}
+
+void clearScreenColor(Color4u color, int screenid)
+{
+  assert(0 <= screenid && screenid < screens.size());
+  DrawCommand command {};
+  command._type = DrawCommand::Type::CLEAR;
+  command._color = color;
+  submitCommand(screens[screenid], command);
+}
+
+void drawSprite(Vector2i position, ResourceKey_t sheetKey, int spriteid, int screenid, 
+                bool mirrorX, bool mirrorY)
+{
+  assert(0 <= screenid && screenid < screens.size());
+  assert(0 <= spriteid);
+  assert(isErrorSpritesheet(sheetKey) || isSpritesheetLoading(sheetKey) || spriteid < getSpriteCount(sheetKey));
+
+  DrawCommand command {};
+  command._type = DrawCommand::Type::SPRITE;
+  command._p0 = position;
+  command._resourceKey = sheetKey;
+  command._spriteid = spriteid;
+  command._mirrorX = mirrorX;
+  command._mirrorY = mirrorY;
+  bindCommandResources(command);
+  submitCommand(screens[screenid], command);
+}
+
+void drawSpriteColumn(Vector2i position, ResourceKey_t sheetKey, int spriteid, int colid, int screenid)
+{
+  assert(0 <= screenid && screenid < screens.size());
+  assert(spritesheets.isValid(sheetKey));
+  assert(0 <= spriteid);
+
+  DrawCommand command {};
+  command._type = DrawCommand::Type::SPRITE_COLUMN;
+  command._p0 = position;
+  command._resourceKey = sheetKey;
+  command._spriteid = spriteid;   // may be an error sheet with 1 sprite.
+  command._colid = colid;
+  bindCommandResources(command);
+  submitCommand(screens[screenid], command);
+}
+
+//
+// Returns true if the font and color missed the tinted font cache recently, else records the
+// miss, overwriting the oldest recorded miss.
+//
+static bool isRepeatTintedFontMiss(ResourceKey_t fontKey, Color4u color)
+{
+  for(const auto& miss : tintedFontMissHistory)
+    if(miss._fontKey == fontKey && memcmp(&miss._color, &color, sizeof(Color4u)) == 0)
+      return true;
+  tintedFontMissHistory[tintedFontMissHead] = TintedFontMiss{fontKey, color};
+  tintedFontMissHead = (tintedFontMissHead + 1) % TINTED_FONT_MISS_HISTORY_SIZE;
+  return false;
+}
+
+//
+// Returns the font tinted to a color from the cache, tinting it on a repeat miss, or nullptr if
+// the text should be drawn untinted: on a first miss, if all cache entries are pinned, or if the
+// color's alpha is the alpha key, as the tinted glyphs would then be transparent.
+//
+static const Spritesheet* findTintedFont(ResourceKey_t fontKey, const Font& font, Color4u color)
+{
+  if(color._a == ALPHA_KEY)
+    return nullptr;
+
+  ++tintedFontTick;
+
+  TintedFont* victim {nullptr};
+  for(auto& entry : tintedFonts){
+    if(entry._fontKey == fontKey && entry._generation == resourceGeneration &&
+       memcmp(&entry._color, &color, sizeof(Color4u)) == 0)
+    {
+      entry._lastUseTick = tintedFontTick;
+      entry._lastUseFlush = flushCount;
+      ++tintedFontHits;
+      return &entry._sheet;
+    }
+    if(isCommandBufferEnabled && entry._lastUseFlush == flushCount)
+      continue;
+    if(victim == nullptr || entry._lastUseTick < victim->_lastUseTick)
+      victim = &entry;
+  }
+
+  ++tintedFontMisses;
+  if(victim == nullptr || !isRepeatTintedFontMiss(fontKey, color))
+    return nullptr;
+
+  victim->_fontKey = fontKey;
+  victim->_color = color;
+  victim->_generation = resourceGeneration;
+  victim->_lastUseTick = tintedFontTick;
+  victim->_lastUseFlush = flushCount;
+
+  Spritesheet& sheet = victim->_sheet;
+  sheet._image.create(font._image.getSize(), Color4u{ALPHA_KEY, ALPHA_KEY, ALPHA_KEY, ALPHA_KEY});
+  for(int row = 0; row < font._image.getHeight(); ++row){
+    const Color4u* src = font._image.getRow(row);
+    Color4u* dst = sheet._image.getRow(row);
+    for(int col = 0; col < font._image.getWidth(); ++col)
+      if(src[col]._a != ALPHA_KEY)
+        dst[col] = color;
+  }
+
+  sheet._sprites.clear();
+  for(const auto& glyph : font._glyphs)
+    sheet._sprites.push_back(Sprite{{glyph._x, glyph._y}, {glyph._width, glyph._height}, {0, 0}, 0});
+  encodeSpriteRuns(sheet);
+
+  return &sheet;
+}
+
+void drawText(Vector2i position, const std::string& text, ResourceKey_t fontKey, Color4u color, int screenid)
+{
+  assert(0 <= screenid && screenid < screens.size());
+  assert(fonts.isValid(fontKey));
+
+  DrawCommand command {};
+  command._type = DrawCommand::Type::TEXT;
+  command._p0 = position;
+  command._resourceKey = fontKey;
+  command._color = color;
+  bindCommandResources(command);
+  command._sheet = findTintedFont(fontKey, *command._font, color);
+  submitCommand(screens[screenid], command, text);
+}
+
+void drawTextLayout(Vector2i position, TextLayout& layout, Color4u color, int screenid)
+{
+  assert(0 <= screenid && screenid < screens.size());
+
+  layout.update();
+
+  DrawCommand command {};
+  command._type = DrawCommand::Type::TEXT_LAYOUT;
+  command._p0 = position;
+  command._layout = &layout;
+  command._color = color;
+  submitCommand(screens[screenid], command);
+}
+
+void drawBorderRectangle(iRect rect, Color4u color, int screenid)
+{
+  assert(0 <= screenid && screenid < screens.size());
+  DrawCommand command {};
+  command._type = DrawCommand::Type::BORDER_RECTANGLE;
+  command._rect = rect;
+  command._color = color;
+  submitCommand(screens[screenid], command);
+}
+
+void drawFillRectangle(iRect rect, Color4u color, int screenid)
+{
+  assert(0 <= screenid && screenid < screens.size());
+  DrawCommand command {};
+  command._type = DrawCommand::Type::FILL_RECTANGLE;
+  command._rect = rect;
+  command._color = color;
+  submitCommand(screens[screenid], command);
+}
+
+void drawLine(Vector2i p0, Vector2i p1, Color4u color, int screenid)
+{
+  assert(0 <= screenid && screenid < screens.size());
+  DrawCommand command {};
+  command._type = DrawCommand::Type::LINE;
+  command._p0 = p0;
+  command._p1 = p1;
+  command._color = color;
+  submitCommand(screens[screenid], command);
+}
+
+void drawLines(const std::vector<Vector2i>& vertices, Color4u color, int screenid)
+{
+  assert(0 <= screenid && screenid < screens.size());
+  DrawCommand command {};
+  command._type = DrawCommand::Type::LINES;
+  command._color = color;
+  submitCommand(screens[screenid], command, {}, vertices);
+}
+
+void drawPoint(Vector2i position, Color4u color, int screenid)
+{
+  assert(0 <= screenid && screenid < screens.size());
+  DrawCommand command {};
+  command._type = DrawCommand::Type::POINT;
+  command._p0 = position;
+  command._color = color;
+  submitCommand(screens[screenid], command);
+}
+
+void drawCommandList(Vector2i position, CommandList& list, int screenid)
+{
+  assert(0 <= screenid && screenid < screens.size());
+
+  if(!list._isRasterised || list._rasterisedGeneration != resourceGeneration){
+    if(isCommandBufferEnabled && list._recordedFlush == flushCount)
+      flushCommands();   // recorded draws of the list point to its cache.
+    list.rasterise();
+  }
+
+  DrawCommand command {};
+  command._type = DrawCommand::Type::SPRITE;
+  command._p0 = position;
+  command._sheet = &list._cache;
+  command._sprite = &list._cache._sprites[0];
+  submitCommand(screens[screenid], command);
+  if(isCommandBufferEnabled)
+    list._recordedFlush = flushCount;
+}
+
+CommandList::CommandList(Vector2i canvasSize) :
+  _commands{},
+  _text{},
+  _canvas{},
+  _cache{},
+  _rasterisedGeneration{-1},
+  _recordedFlush{-1},
+  _isRasterised{false}
+{
+  assert(canvasSize._x > 0 && canvasSize._y > 0);
+
+  _canvas._pxShader = pxShaderDefault;
+  _canvas._xmode = PixelMode::NO_SHADER;
+  _canvas._resolution = canvasSize;
+  _canvas._pxCount = canvasSize._x * canvasSize._y;
+  _canvas._pxColors = new Color4u[_canvas._pxCount];
+  _canvas._tileGrid._x = (canvasSize._x + SCREEN_TILE_SIZE - 1) / SCREEN_TILE_SIZE;
+  _canvas._tileGrid._y = (canvasSize._y + SCREEN_TILE_SIZE - 1) / SCREEN_TILE_SIZE;
+  _canvas._dirtyTiles = new uint8_t[_canvas._tileGrid._x * _canvas._tileGrid._y];
+
+  Sprite sprite {};
+  sprite._size = canvasSize;
+  _cache._image.create(canvasSize, Color4u{ALPHA_KEY, ALPHA_KEY, ALPHA_KEY, ALPHA_KEY});
+  _cache._sprites.push_back(sprite);
+}
+
+CommandList::~CommandList()
+{
+  delete[] _canvas._pxColors;
+  delete[] _canvas._dirtyTiles;
+}
+
+void CommandList::clear()
+{
+  _commands.clear();
+  _text.clear();
+  _vertices.clear();
+  _isRasterised = false;
+}
+
+void CommandList::record(DrawCommand& command, const std::string& text, 
+                         const std::vector<Vector2i>& vertices)
+{
+  command._xmode = PixelMode::NO_SHADER;
+  command._shader = pxShaderDefault;
+  command._textOffset = _text.size();
+  command._textLength = text.size();
+  _text += text;
+  command._vertexOffset = _vertices.size();
+  command._vertexCount = vertices.size();
+  _vertices.insert(_vertices.end(), vertices.begin(), vertices.end());
+  bindCommandResources(command);
+  _commands.push_back(command);
+  _isRasterised = false;
+}
+
+//
+// Rasterises the recorded commands onto the canvas and then caches the canvas as a single 
+// sprite spritesheet (with its opaque runs) for compositing. Commands are rebound to their 
+// resources first if any resources have been unloaded since they were bound.
+//
+void CommandList::rasterise()
+{
+  if(_rasterisedGeneration != resourceGeneration)
+    for(auto& command : _commands)
+      bindCommandResources(command);
+
+  DrawTarget target {&_canvas, 0, _canvas._resolution._y, nullptr};
+  clearImpl(target, Color4u{ALPHA_KEY, ALPHA_KEY, ALPHA_KEY, ALPHA_KEY});
+  for(const auto& command : _commands)
+    executeCommand(target, command, _text.data(), _vertices.data());
+
+  int width = _canvas._resolution._x;
+  for(int row = 0; row < _canvas._resolution._y; ++row)
+    memcpy(static_cast<void*>(_cache._image.getRow(row)), 
+           static_cast<const void*>(_canvas._pxColors + (row * width)), width * sizeof(Color4u));
+  encodeSpriteRuns(_cache);
+
+  _rasterisedGeneration = resourceGeneration;
+  _isRasterised = true;
+}
+
+void CommandList::drawSprite(Vector2i position, ResourceKey_t sheetKey, int spriteid, bool mirrorX, bool mirrorY)
+{
+  DrawCommand command {};
+  command._type = DrawCommand::Type::SPRITE;
+  command._p0 = position;
+  command._resourceKey = sheetKey;
+  command._spriteid = spriteid;
+  command._mirrorX = mirrorX;
+  command._mirrorY = mirrorY;
+  record(command);
+}
+
+void CommandList::drawSpriteColumn(Vector2i position, ResourceKey_t sheetKey, int spriteid, int colid)
+{
+  DrawCommand command {};
+  command._type = DrawCommand::Type::SPRITE_COLUMN;
+  command._p0 = position;
+  command._resourceKey = sheetKey;
+  command._spriteid = spriteid;
+  command._colid = colid;
+  record(command);
+}
+
+void CommandList::drawText(Vector2i position, const std::string& text, ResourceKey_t fontKey, Color4u color)
+{
+  DrawCommand command {};
+  command._type = DrawCommand::Type::TEXT;
+  command._p0 = position;
+  command._resourceKey = fontKey;
+  command._color = color;
+  record(command, text);
+}
+
+void CommandList::drawBorderRectangle(iRect rect, Color4u color)
+{
+  DrawCommand command {};
+  command._type = DrawCommand::Type::BORDER_RECTANGLE;
+  command._rect = rect;
+  command._color = color;
+  record(command);
+}
+
+void CommandList::drawFillRectangle(iRect rect, Color4u color)
+{
+  DrawCommand command {};
+  command._type = DrawCommand::Type::FILL_RECTANGLE;
+  command._rect = rect;
+  command._color = color;
+  record(command);
+}
+
+void CommandList::drawLine(Vector2i p0, Vector2i p1, Color4u color)
+{
+  DrawCommand command {};
+  command._type = DrawCommand::Type::LINE;
+  command._p0 = p0;
+  command._p1 = p1;
+  command._color = color;
+  record(command);
+}
+
+void CommandList::drawLines(const std::vector<Vector2i>& vertices, Color4u color)
+{
+  DrawCommand command {};
+  command._type = DrawCommand::Type::LINES;
+  command._color = color;
+  record(command, {}, vertices);
+}
+
+void CommandList::drawPoint(Vector2i position, Color4u color)
+{
+  DrawCommand command {};
+  command._type = DrawCommand::Type::POINT;
+  command._p0 = position;
+  command._color = color;
+  record(command);
+}
+
+void enableCommandBuffer()
+{
+  isCommandBufferEnabled = true;
+}
+
+void disableCommandBuffer()
+{
+  flushCommands();
+  isCommandBufferEnabled = false;
+}
+
+void flushCommands()
+{
+  PXR_PROFILE_SCOPE("gfx::flushCommands");
+
+  //
+  // Unpins the tinted fonts; none are looked up (or evicted) until the flush completes.
+  //
+  ++flushCount;
+
+  //
+  // Split every screen with recorded commands into bands of whole tile rows and draw all bands
+  // of all screens as a single batch of jobs. Screens are split into a few more bands than 
+  // there are threads so threads finishing early can pick up the slack; without workers each
+  // screen is a single band.
+  //
+  struct Band
+  {
+    Screen* _screen;
+    int _rowBegin;
+    int _rowEnd;
+  };
+
+  static std::vector<Band> bands;
+  bands.clear();
+
+  int threadCount = worker::getWorkerCount() + 1;
+  int bandsPerScreen = (threadCount == 1) ? 1 : threadCount * BANDS_PER_THREAD;
+  for(auto& screen : screens){
+    if(screen._commands.empty())
+      continue;
+    int bandCount = std::min(screen._tileGrid._y, bandsPerScreen);
+    int tileRowsPerBand = (screen._tileGrid._y + bandCount - 1) / bandCount;
+    int rowsPerBand = tileRowsPerBand * SCREEN_TILE_SIZE;
+    for(int rowBegin = 0; rowBegin < screen._resolution._y; rowBegin += rowsPerBand)
+      bands.push_back(Band{&screen, rowBegin, std::min(rowBegin + rowsPerBand, screen._resolution._y)});
+  }
+
+  if(bands.empty())
+    return;
+
+  worker::parallelFor(bands.size(), [](int i){
+    PXR_PROFILE_SCOPE("gfx::drawBand");
+    const Band& band = bands[i];
+    Screen& screen = *band._screen;
+    DrawTarget target {&screen, band._rowBegin, band._rowEnd, nullptr};
+    for(const auto& command : screen._commands)
+      executeCommand(target, command, screen._commandText.data(), screen._commandVertices.data());
+  });
+
+  for(auto& screen : screens){
+    screen._commands.clear();
+    screen._commandText.clear();
+    screen._commandVertices.clear();
+  }
+}
+
+void present()
+{
+  PXR_PROFILE_SCOPE("gfx::present");
+
+  flushCommands();
+
+  pxUploadedLastPresent = 0;
+  pxCountLastPresent = 0;
+  for(auto& screen : screens){
+    if(!screen._isEnabled) 
+      continue;
+
+    postProcessDirtyTiles(screen);
+
+    PXR_PROFILE_SCOPE("gfx::uploadScreen");
+    if(!isHeadlessMode)
+      glBindTexture(GL_TEXTURE_2D, screen._texture);
+    uploadDirtyTiles(screen);
+    pxUploadedLastPresent += screen._pxUploaded;
+    pxCountLastPresent += screen._pxCount;
+    if(isHeadlessMode)
+      continue;
+    glVertexPointer(2, GL_INT, 0, screen._quadPositions);
+    glTexCoordPointer(2, GL_FLOAT, 0, quadTexCoords);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  }
+
+  if(!isHeadlessMode){
+    PXR_PROFILE_SCOPE("gfx::swapWindow");
+    SDL_GL_SwapWindow(window);
+  }
+
+  publishAsyncLoads();
+}
+
+void setScreenPixelMode(PixelMode mode, int screenid)
+{
+  assert(0 <= screenid && screenid < screens.size());
+  screens[screenid]._xmode = mode;
+}
+
+void setScreenSizeMode(SizeMode mode, int screenid)
+{
+  assert(0 <= screenid && screenid < screens.size());
+  auto& screen = screens[screenid];
+  screen._smode = mode;
+  autoAdjustScreen(windowSize, screen);
+}
+
+void setScreenPositionMode(PositionMode mode, int screenid)
+{
+  assert(0 <= screenid && screenid < screens.size());
+  auto& screen = screens[screenid];
+  screen._pmode = mode;
+  autoAdjustScreen(windowSize, screen);
+}
+
+void setScreenManualPosition(Vector2i position, int screenid)
+{
+  assert(0 <= screenid && screenid < screens.size());
+  auto& screen = screens[screenid];
+  screen._manualPosition = position;
+  if(screen._pmode == PositionMode::MANUAL)
+    autoAdjustScreen(windowSize, screen);
+}
+
+void setScreenManualPixelSize(int pxSize, int screenid)
 {
   assert(0 <= screenid && screenid < screens.size());
   auto& screen = screens[screenid];
@@ -974,6 +3130,66 @@ void setPixelShader(PXShader_t shader, int screenid)
   screen._pxShader = shader;
 }
 
+void addScreenPostProcess(PXShader_t effect, int screenid)
+{
+  assert(effect != nullptr);
+  assert(0 <= screenid && screenid < screens.size());
+  auto& screen = screens[screenid];
+  if(screen._ppColors == nullptr)
+    screen._ppColors = new Color4u[screen._pxCount];
+  screen._postProcesses.push_back(effect);
+  markAllDirty(screen);
+}
+
+void clearScreenPostProcesses(int screenid)
+{
+  assert(0 <= screenid && screenid < screens.size());
+  auto& screen = screens[screenid];
+  screen._postProcesses.clear();
+  delete[] screen._ppColors;
+  screen._ppColors = nullptr;
+  markAllDirty(screen);
+}
+
+void postProcessScanlines(Color4u* span, int count, int /*pxx*/, int pxy)
+{
+  if((pxy & 1) == 0)
+    return;
+  for(int i = 0; i < count; ++i){
+    span[i]._r >>= 1;
+    span[i]._g >>= 1;
+    span[i]._b >>= 1;
+  }
+}
+
+void postProcessCrtTint(Color4u* span, int count, int /*pxx*/, int /*pxy*/)
+{
+  for(int i = 0; i < count; ++i){
+    span[i]._r = (span[i]._r * 200) >> 8;
+    span[i]._g = std::min(255, ((span[i]._g * 240) >> 8) + 12);
+    span[i]._b = (span[i]._b * 216) >> 8;
+  }
+}
+
+void postProcessGameboyPalette(Color4u* span, int count, int /*pxx*/, int /*pxy*/)
+{
+  static constexpr Color4u palette[4] {
+    Color4u{15, 56, 15},
+    Color4u{48, 98, 48},
+    Color4u{139, 172, 15},
+    Color4u{155, 188, 15}
+  };
+
+  for(int i = 0; i < count; ++i){
+    // integer approximation of rec. 601 luma; range [0, 255].
+    int luma = ((span[i]._r * 77) + (span[i]._g * 150) + (span[i]._b * 29)) >> 8;
+    const Color4u& shade = palette[luma >> 6];
+    span[i]._r = shade._r;
+    span[i]._g = shade._g;
+    span[i]._b = shade._b;
+  }
+}
+
 void enableScreen(int screenid)
 {
   assert(0 <= screenid && screenid < screens.size());
@@ -986,51 +3202,201 @@ void disableScreen(int screenid)
   screens[screenid]._isEnabled = false;
 }
 
-Vector2i calculateTextSize(const std::string& text, ResourceKey_t fontKey)
+int getScreenCount()
 {
-  Vector2i size{0, 0};
+  return screens.size();
+}
+
+bool isScreenEnabled(int screenid)
+{
+  assert(0 <= screenid && screenid < screens.size());
+  return screens[screenid]._isEnabled;
+}
+
+bool dumpScreen(int screenid, const std::string& filepath)
+{
+  assert(0 <= screenid && screenid < screens.size());
+  const auto& screen = screens[screenid];
+  const Color4u* pixels = screen._postProcesses.empty() ? screen._pxColors : screen._ppColors;
+
+  io::Bmp image {};
+  image.create(screen._resolution, Color4u{ALPHA_KEY, ALPHA_KEY, ALPHA_KEY, ALPHA_KEY});
+  for(int row = 0; row < screen._resolution._y; ++row)
+    memcpy(image.getRow(row), pixels + (row * screen._resolution._x), screen._resolution._x * sizeof(Color4u));
+
+  if(!image.save(filepath)){
+    log::log(log::ERROR, log::msg_gfx_fail_dump_screen, filepath);
+    return false;
+  }
+  return true;
+}
+
+float getScreenDirtyRatio(int screenid)
+{
+  assert(0 <= screenid && screenid < screens.size());
+  const auto& screen = screens[screenid];
+  return static_cast<float>(screen._pxUploaded) / screen._pxCount;
+}
+
+FontCacheStats getFontCacheStats()
+{
+  FontCacheStats stats {};
+  stats._hits = tintedFontHits;
+  stats._misses = tintedFontMisses;
+  for(const auto& entry : tintedFonts)
+    stats._entryCount += (entry._fontKey != -1);
+  stats._capacity = TINTED_FONT_CACHE_SIZE;
+  return stats;
+}
 
-  auto search = fonts.find(fontKey);
-  assert(search != fonts.end());
-  auto& font = search->second._font;
+float getDirtyRatio()
+{
+  if(pxCountLastPresent == 0)
+    return 0.f;
+  return static_cast<float>(pxUploadedLastPresent) / pxCountLastPresent;
+}
 
+static Vector2i calculateTextSize(std::string_view text, const Font& font)
+{
+  Vector2i size{0, 0};
+  int lineWidth {0};
+  int lineCount {1};
   for(char c : text){
-    if(c == '\n') continue;
+    if(c == '\n'){
+      lineWidth = 0;
+      ++lineCount;
+      continue;
+    }
     assert(' ' <= c && c <= '~');
     const Glyph& glyph = font._glyphs[static_cast<int>(c - ' ')];
-    size._x += glyph._xadvance + font._glyphSpace;
-    size._y = size._y < glyph._height ? glyph._height : size._y;
+    lineWidth += glyph._xadvance + font._glyphSpace;
+    size._x = std::max(size._x, lineWidth);
+    size._y = std::max(size._y, glyph._height);
   }
+  size._y += (lineCount - 1) * font._lineHeight;
   return size;
 }
 
+Vector2i calculateTextSize(const std::string& text, ResourceKey_t fontKey)
+{
+  return calculateTextSize(text, resolveFont(fontKey)._font);
+}
+
+TextLayout::TextLayout() :
+  _text{},
+  _fontKey{-1},
+  _spans{},
+  _bounds{0, 0, 0, 0},
+  _size{0, 0},
+  _layoutGeneration{0},
+  _isLaidOut{false}
+{}
+
+TextLayout::TextLayout(std::string_view text, ResourceKey_t fontKey) :
+  TextLayout()
+{
+  _text = text;
+  _fontKey = fontKey;
+}
+
+void TextLayout::setText(std::string_view text)
+{
+  if(text == _text)
+    return;
+  _text.assign(text.begin(), text.end());
+  _isLaidOut = false;
+}
+
+void TextLayout::setFont(ResourceKey_t fontKey)
+{
+  if(fontKey == _fontKey)
+    return;
+  _fontKey = fontKey;
+  _isLaidOut = false;
+}
+
+void TextLayout::update()
+{
+  if(_isLaidOut && _layoutGeneration == resourceGeneration)
+    return;
+
+  assert(fonts.isValid(_fontKey));
+  const Font& font = resolveFont(_fontKey)._font;
+
+  _spans.clear();
+  layoutGlyphs(_text, font, [this, &font](const Glyph& glyph, int x, int y){
+    for(int glyphRow = 0; glyphRow < glyph._height; ++glyphRow){
+      const Color4u* glyphPxs = font._image.getRow(glyph._y + glyphRow) + glyph._x;
+      int glyphCol {0};
+      while(glyphCol < glyph._width){
+        while(glyphCol < glyph._width && glyphPxs[glyphCol]._a == ALPHA_KEY) ++glyphCol;
+        int spanStart = glyphCol;
+        while(glyphCol < glyph._width && glyphPxs[glyphCol]._a != ALPHA_KEY) ++glyphCol;
+        if(glyphCol > spanStart)
+          _spans.push_back(Span{x + spanStart, y + glyphRow, glyphCol - spanStart});
+      }
+    }
+  });
+
+  //
+  // Order the spans by row and merge those which touch (or overlap, where glyphs overlap).
+  //
+  std::sort(_spans.begin(), _spans.end(), [](const Span& a, const Span& b){
+    return a._y < b._y || (a._y == b._y && a._x < b._x);
+  });
+
+  std::size_t merged {0};
+  for(std::size_t i = 0; i < _spans.size(); ++i){
+    Span& last = _spans[merged];
+    if(i > 0 && _spans[i]._y == last._y && _spans[i]._x <= last._x + last._length){
+      last._length = std::max(last._length, _spans[i]._x + _spans[i]._length - last._x);
+      continue;
+    }
+    if(i > 0)
+      ++merged;
+    _spans[merged] = _spans[i];
+  }
+  _spans.resize(_spans.empty() ? 0 : merged + 1);
+
+  int xmin {0}, ymin {0}, xmax {-1}, ymax {-1};
+  if(!_spans.empty()){
+    xmin = ymin = std::numeric_limits<int>::max();
+    xmax = ymax = std::numeric_limits<int>::min();
+    for(const auto& span : _spans){
+      xmin = std::min(xmin, span._x);
+      xmax = std::max(xmax, span._x + span._length - 1);
+    }
+    ymin = _spans.front()._y;
+    ymax = _spans.back()._y;
+  }
+  _bounds = iRect{xmin, ymin, xmax - xmin + 1, ymax - ymin + 1};
+
+  _size = calculateTextSize(_text, font);
+  _layoutGeneration = resourceGeneration;
+  _isLaidOut = true;
+}
+
 bool isErrorSpritesheet(ResourceKey_t sheetKey)
 {
-  auto search = spritesheets.find(sheetKey);
-  assert(search != spritesheets.end());
-  return search->second._name == errorSpritesheetName;
+  return sheetKey == errorSpritesheetKey || spritesheets[sheetKey]._state == LoadState::FAILED;
 }
 
 Vector2i getSpritesheetSize(ResourceKey_t sheetKey)
 {
-  auto search = spritesheets.find(sheetKey);
-  assert(search != spritesheets.end());
-  return search->second._sheet._image.getSize();
+  return resolveSpritesheet(sheetKey)._sheet._image.getSize();
 }
 
 Vector2i getSpriteSize(ResourceKey_t sheetKey, int spriteid)
 {
-  auto search = spritesheets.find(sheetKey);
-  assert(search != spritesheets.end());
-  assert(0 <= spriteid && spriteid < search->second._sheet._sprites.size());
-  return search->second._sheet._sprites[spriteid]._size;
+  const Spritesheet& sheet = resolveSpritesheet(sheetKey)._sheet;
+  assert(0 <= spriteid);
+  assert(spriteid < sheet._sprites.size() || isErrorSpritesheet(sheetKey) || isSpritesheetLoading(sheetKey));
+  return sheet._sprites[spriteid < sheet._sprites.size() ? spriteid : 0]._size;
 }
 
 const Spritesheet& getSpritesheet(ResourceKey_t sheetKey)
 {
-  auto search = spritesheets.find(sheetKey);
-  assert(search != spritesheets.end());
-  return search->second._sheet;
+  return resolveSpritesheet(sheetKey)._sheet;
 }
 
 } // namespace gfx
@@ -1,5 +1,10 @@
 #include <cassert>
+#include <array>
+#include <algorithm>
+#include <cstdint>
+#include <string_view>
 #include "pxr_hud.h"
+#include "pxr_prof.h"
 
 namespace pxr
 {
@@ -80,9 +85,8 @@ HUD::TextLabel::TextLabel(
   gfx::ResourceKey_t fontKey)
   :
   Label(position, color, activationDelay, lifetime),
-  _fontKey{fontKey},
   _fullText{text},
-  _visibleText{phaseIn ? std::string{} : text},
+  _layout{phaseIn ? std::string_view{} : std::string_view{text}, fontKey},
   _nextCharToShow{0},
   _isPhasingIn{phaseIn}
 {}
@@ -92,7 +96,7 @@ void HUD::TextLabel::onReset()
   Label::onReset();
 
   if(_isPhasingIn){
-    _visibleText.clear();
+    _layout.setText({});
     _nextCharToShow = 0;
   }
 }
@@ -105,15 +109,15 @@ void HUD::TextLabel::onUpdate(float dt)
 
   if(_isPhasingIn && _nextCharToShow < _fullText.length() && _lastPhaseInNo != _owner->getPhaseInNo()){
     _lastPhaseInNo = _owner->getPhaseInNo(); 
-    _visibleText += _fullText[_nextCharToShow];
     ++_nextCharToShow;
+    _layout.setText(std::string_view{_fullText}.substr(0, _nextCharToShow));
   }
 }
 
 void HUD::TextLabel::onDraw(gfx::ScreenID_t screenid)
 {
   if(_isActive && !_isHidden && _flashState)
-    gfx::drawText(_position, _visibleText, _fontKey, _color, screenid);
+    gfx::drawTextLayout(_position, _layout, _color, screenid);
 }
 
 HUD::IntLabel::IntLabel(
@@ -126,10 +130,10 @@ HUD::IntLabel::IntLabel(
   gfx::ResourceKey_t fontKey)
   :
   Label(position, color, activationDelay, lifetime),
-  _fontKey{fontKey},
   _sourceValue{sourceValue},
   _displayValue{sourceValue},
-  _precision{precision}
+  _precision{precision},
+  _layout{{}, fontKey}
 {
   composeDisplayStr();
 }
@@ -154,23 +158,37 @@ void HUD::IntLabel::onUpdate(float dt)
 void HUD::IntLabel::onDraw(gfx::ScreenID_t screenid)
 {
   if(_isActive && !_isHidden && _flashState)
-    gfx::drawText(_position, _displayStr, _fontKey, _color, screenid);
+    gfx::drawTextLayout(_position, _layout, _color, screenid);
 }
 
 void HUD::IntLabel::composeDisplayStr()
 {
-  std::string valueStr = std::to_string(_sourceValue);
-  _displayStr.clear();
-  int sign{0};
-  if(_sourceValue < 0){
-    assert(valueStr.front() == '-');
-    sign = 1;
-    _displayStr += '-';
-  }
-  for(int i{0}; i < _precision - (valueStr.length() - sign); ++i){
-    _displayStr += '0';
-  }
-  _displayStr.append(valueStr.begin() + sign, valueStr.end());
+  //
+  // Digits are written backwards from the end of a buffer, then zero padded to the precision, 
+  // so no strings are allocated. The value is widened so negating INT_MIN cannot overflow.
+  //
+  std::array<char, 32> buffer;
+  int end = buffer.size();
+  int begin = end;
+
+  int64_t value = _sourceValue;
+  bool isNegative = value < 0;
+  if(isNegative)
+    value = -value;
+
+  do {
+    buffer[--begin] = '0' + (value % 10);
+    value /= 10;
+  } while(value > 0);
+
+  int precision = std::min(_precision, end - 1);
+  while(end - begin < precision)
+    buffer[--begin] = '0';
+
+  if(isNegative)
+    buffer[--begin] = '-';
+
+  _layout.setText(std::string_view{buffer.data() + begin, static_cast<std::size_t>(end - begin)});
 }
 
 HUD::BitmapLabel::BitmapLabel(
@@ -225,6 +243,8 @@ void HUD::onReset()
 
 void HUD::onUpdate(float dt)
 {
+  PXR_PROFILE_SCOPE("hud::onUpdate");
+
   _flashClock += dt;
   if(_flashClock >= _flashPeriod){
     _flashClock = 0.f;
@@ -249,6 +269,7 @@ void HUD::onUpdate(float dt)
 
 void HUD::onDraw(gfx::ScreenID_t screenid)
 {
+  PXR_PROFILE_SCOPE("hud::onDraw");
   for(auto& label : _labels)
     label->onDraw(screenid);
 }
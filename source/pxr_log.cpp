@@ -1,5 +1,6 @@
 #include <iostream>
 #include <fstream>
+#include <mutex>
 #include "pxr_log.h"
 
 namespace pxr
@@ -9,6 +10,11 @@ namespace log
 
 static std::ofstream _os;
 
+//
+// Serialises logging from worker threads, e.g. by background asset loads.
+//
+static std::mutex _mutex;
+
 void initialize()
 {
   _os.open(LOG_FILENAME, std::ios_base::trunc);
@@ -26,6 +32,7 @@ void shutdown()
 
 void log(Level level, const char* error, const std::string& addendum)
 {
+  std::lock_guard<std::mutex> lock {_mutex};
   std::ostream& os {_os ? _os : std::cerr}; 
   os << prefix[level] << LOG_DELIM << error;
   if(!addendum.empty())
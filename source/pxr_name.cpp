@@ -0,0 +1,59 @@
+#include <deque>
+#include <cassert>
+#include "pxr_name.h"
+
+namespace pxr
+{
+namespace name
+{
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// MODULE DATA
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////
+
+//
+// The interned strings indexed by name id. Held in a deque so strings never move, which allows
+// the lookup table to key on views of them.
+//
+static std::deque<std::string> names;
+static std::unordered_map<std::string_view, NameID_t> nameids;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// MODULE FUNCTIONS
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////
+
+NameID_t intern(std::string_view name)
+{
+  auto search = nameids.find(name);
+  if(search != nameids.end())
+    return search->second;
+
+  NameID_t nameid = names.size();
+  names.emplace_back(name);
+  nameids.emplace(std::string_view{names.back()}, nameid);
+  return nameid;
+}
+
+NameID_t find(std::string_view name)
+{
+  auto search = nameids.find(name);
+  return search == nameids.end() ? nullNameID : search->second;
+}
+
+const std::string& getString(NameID_t nameid)
+{
+  assert(0 <= nameid && nameid < static_cast<NameID_t>(names.size()));
+  return names[nameid];
+}
+
+int getCount()
+{
+  return names.size();
+}
+
+} // namespace name
+} // namespace pxr
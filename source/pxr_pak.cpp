@@ -0,0 +1,170 @@
+#include <array>
+#include <string>
+#include <cstring>
+#include <cassert>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "pxr_pak.h"
+#include "pxr_name.h"
+#include "pxr_log.h"
+
+namespace pxr
+{
+namespace pak
+{
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// MODULE DATA
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////
+
+static uint8_t* mapping {nullptr};
+static std::size_t mappingSize {0};
+static const Entry* entries {nullptr};
+
+//
+// Maps the interned names of the resources in the archive to the index of their entry; one map
+// per entry type.
+//
+static std::array<name::KeyMap<int>, static_cast<int>(EntryType::COUNT)> entryIndices;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// MODULE FUNCTIONS
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool validateArchive(const char* path)
+{
+  if(mappingSize < sizeof(Header)){
+    log::log(log::ERROR, log::msg_pak_corrupted, path);
+    return false;
+  }
+
+  const Header* header = reinterpret_cast<const Header*>(mapping);
+  if(header->_magic != ARCHIVE_MAGIC){
+    log::log(log::ERROR, log::msg_pak_corrupted, path);
+    return false;
+  }
+
+  if(header->_version != ARCHIVE_VERSION){
+    std::string addendum {path};
+    addendum += " version=";
+    addendum += std::to_string(header->_version);
+    addendum += " expected=";
+    addendum += std::to_string(ARCHIVE_VERSION);
+    log::log(log::ERROR, log::msg_pak_wrong_version, addendum);
+    return false;
+  }
+
+  uint64_t tableSize = static_cast<uint64_t>(header->_entryCount) * sizeof(Entry);
+  if(header->_entryTableOffset > mappingSize || tableSize > mappingSize - header->_entryTableOffset){
+    log::log(log::ERROR, log::msg_pak_corrupted, path);
+    return false;
+  }
+
+  entries = reinterpret_cast<const Entry*>(mapping + header->_entryTableOffset);
+  for(uint32_t i = 0; i < header->_entryCount; ++i){
+    const Entry& entry = entries[i];
+    if(entry._offset > mappingSize || entry._size > mappingSize - entry._offset ||
+       entry._offset % DATA_ALIGNMENT != 0 ||
+       entry._type >= EntryType::COUNT ||
+       memchr(entry._name, '\0', NAME_MAX_LENGTH) == nullptr)
+    {
+      log::log(log::ERROR, log::msg_pak_corrupted, path);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool open(const char* path)
+{
+  close();
+
+  int fd = ::open(path, O_RDONLY);
+  if(fd < 0){
+    log::log(log::INFO, log::msg_pak_no_archive, path);
+    return false;
+  }
+
+  struct stat st {};
+  if(fstat(fd, &st) < 0 || st.st_size == 0){
+    log::log(log::ERROR, log::msg_pak_corrupted, path);
+    ::close(fd);
+    return false;
+  }
+
+  mappingSize = static_cast<std::size_t>(st.st_size);
+  void* addr = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  ::close(fd);     // the mapping remains valid after the file is closed.
+  if(addr == MAP_FAILED){
+    log::log(log::ERROR, log::msg_pak_fail_map, path);
+    mappingSize = 0;
+    return false;
+  }
+  mapping = static_cast<uint8_t*>(addr);
+
+  if(!validateArchive(path)){
+    close();
+    return false;
+  }
+
+  const Header* header = reinterpret_cast<const Header*>(mapping);
+  for(uint32_t i = 0; i < header->_entryCount; ++i){
+    const Entry& entry = entries[i];
+    entryIndices[static_cast<int>(entry._type)].insert(name::intern(entry._name), i);
+  }
+
+  std::string addendum {path};
+  addendum += " entries=";
+  addendum += std::to_string(header->_entryCount);
+  addendum += " size=";
+  addendum += std::to_string(mappingSize);
+  addendum += "B";
+  log::log(log::INFO, log::msg_pak_opened, addendum);
+
+  return true;
+}
+
+void close()
+{
+  if(mapping != nullptr)
+    munmap(mapping, mappingSize);
+  mapping = nullptr;
+  mappingSize = 0;
+  entries = nullptr;
+  for(auto& indices : entryIndices)
+    indices.clear();
+}
+
+bool isOpen()
+{
+  return mapping != nullptr;
+}
+
+const Entry* find(EntryType type, std::string_view name)
+{
+  if(mapping == nullptr)
+    return nullptr;
+
+  name::NameID_t nameid = name::find(name);
+  if(nameid == name::nullNameID)
+    return nullptr;
+
+  int index = entryIndices[static_cast<int>(type)].find(nameid);
+  return index == -1 ? nullptr : &entries[index];
+}
+
+uint8_t* getData(const Entry& entry)
+{
+  assert(mapping != nullptr);
+  return mapping + entry._offset;
+}
+
+} // namespace pak
+} // namespace pxr
@@ -2,6 +2,7 @@
 #include <cassert>
 #include "pxr_particle.h"
 #include "pxr_gfx.h"
+#include "pxr_prof.h"
 
 namespace pxr
 {
@@ -22,6 +23,7 @@ ParticleEngine::~ParticleEngine()
 
 void ParticleEngine::update(float dt)
 {
+  PXR_PROFILE_SCOPE("particle::update");
   assert(_particles != nullptr);
 
   int numUpdates{0}, i{0};
@@ -48,6 +50,7 @@ void ParticleEngine::update(float dt)
 
 void ParticleEngine::draw(int screenid)
 {
+  PXR_PROFILE_SCOPE("particle::draw");
   assert(_particles != nullptr);
   for(int i = 0; i < _config._maxParticles; ++i){
     auto& particle = _particles[i];
@@ -0,0 +1,292 @@
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <deque>
+#include <memory>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <cstring>
+#include "pxr_prof.h"
+#include "pxr_log.h"
+
+namespace pxr
+{
+namespace prof
+{
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// MODULE DATA
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////
+
+using Clock_t = std::chrono::steady_clock;
+
+static const Clock_t::time_point epoch {Clock_t::now()};
+
+static std::atomic<bool> isProfiling {true};
+
+//
+// A slot of an event ring buffer, stamped with the sequence number (index + 1) of the event it
+// holds, or 0 whilst empty or being written. The fields are atomics (accessed relaxed) as a 
+// reader may read a slot whilst the writer overwrites it; the reader detects this by the stamp
+// changing and drops the event (a seqlock).
+//
+struct Slot
+{
+  std::atomic<uint64_t> _sequence;
+  std::atomic<const char*> _name;
+  std::atomic<int64_t> _start;
+  std::atomic<int64_t> _duration;
+  std::atomic<int> _depth;
+};
+
+//
+// The event ring buffer of a thread. Only the owning thread writes to its buffer; it writes
+// each event then publishes it by incrementing the count (release), so other threads can read
+// the events below the count (acquire). Event i is stored at [i % EVENTS_PER_THREAD]. As the
+// writer keeps running whilst others read, the oldest events read may be overwritten; see Slot.
+//
+// Events are recorded when their scopes end thus are ordered by end time within a buffer.
+//
+struct ThreadBuffer
+{
+  std::unique_ptr<Slot[]> _slots;
+  std::atomic<uint64_t> _count;
+  std::string _name;
+  int _id;
+};
+
+//
+// Buffers are created on the first event of each thread and never destroyed (threads which
+// exit leave their events to be exported). Held in a deque so buffers never move. The mutex
+// guards the deque and the buffer names, not the events.
+//
+static std::mutex buffersMutex;
+static std::deque<ThreadBuffer> buffers;
+
+static thread_local ThreadBuffer* threadBuffer {nullptr};
+static thread_local int threadDepth {0};
+
+static std::vector<ScopeTotal> frameBreakdown;
+static int64_t frameDuration {0};
+static int64_t lastFrameStart {-1};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// MODULE FUNCTIONS
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int64_t now()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock_t::now() - epoch).count();
+}
+
+static ThreadBuffer& getThreadBuffer()
+{
+  if(threadBuffer == nullptr){
+    std::lock_guard<std::mutex> lock {buffersMutex};
+    ThreadBuffer& buffer = buffers.emplace_back();
+    buffer._slots = std::make_unique<Slot[]>(EVENTS_PER_THREAD);
+    buffer._count.store(0, std::memory_order_relaxed);
+    buffer._id = buffers.size();
+    buffer._name = "thread " + std::to_string(buffer._id);
+    threadBuffer = &buffer;
+  }
+  return *threadBuffer;
+}
+
+static void record(const Event& event)
+{
+  ThreadBuffer& buffer = getThreadBuffer();
+  uint64_t count = buffer._count.load(std::memory_order_relaxed);
+  Slot& slot = buffer._slots[count % EVENTS_PER_THREAD];
+  slot._sequence.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot._name.store(event._name, std::memory_order_relaxed);
+  slot._start.store(event._start, std::memory_order_relaxed);
+  slot._duration.store(event._duration, std::memory_order_relaxed);
+  slot._depth.store(event._depth, std::memory_order_relaxed);
+  slot._sequence.store(count + 1, std::memory_order_release);
+  buffer._count.store(count + 1, std::memory_order_release);
+}
+
+//
+// Reads event i of a buffer from another thread. Returns false if the event has been (or is 
+// being) overwritten.
+//
+static bool readEvent(const ThreadBuffer& buffer, uint64_t i, Event& event)
+{
+  const Slot& slot = buffer._slots[i % EVENTS_PER_THREAD];
+  if(slot._sequence.load(std::memory_order_acquire) != i + 1)
+    return false;
+  event._name = slot._name.load(std::memory_order_relaxed);
+  event._start = slot._start.load(std::memory_order_relaxed);
+  event._duration = slot._duration.load(std::memory_order_relaxed);
+  event._depth = slot._depth.load(std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return slot._sequence.load(std::memory_order_relaxed) == i + 1;
+}
+
+Scope::Scope(const char* name) :
+  _name{name},
+  _start{-1}
+{
+  if(!isProfiling.load(std::memory_order_relaxed))
+    return;
+  ++threadDepth;
+  _start = now();
+}
+
+Scope::~Scope()
+{
+  if(_start < 0)
+    return;
+  int64_t end = now();
+  --threadDepth;
+  record(Event{_name, _start, end - _start, threadDepth});
+}
+
+void enable()
+{
+  isProfiling.store(true, std::memory_order_relaxed);
+}
+
+void disable()
+{
+  isProfiling.store(false, std::memory_order_relaxed);
+}
+
+bool isEnabled()
+{
+  return isProfiling.load(std::memory_order_relaxed);
+}
+
+void setThreadName(const char* name)
+{
+  ThreadBuffer& buffer = getThreadBuffer();
+  std::lock_guard<std::mutex> lock {buffersMutex};
+  buffer._name = name;
+}
+
+static void addToBreakdown(const Event& event)
+{
+  for(auto& total : frameBreakdown){
+    if(total._name == event._name || strcmp(total._name, event._name) == 0){
+      total._duration += event._duration;
+      ++total._count;
+      return;
+    }
+  }
+  frameBreakdown.push_back(ScopeTotal{event._name, event._duration, 1});
+}
+
+void beginFrame()
+{
+  int64_t frameStart = now();
+  frameBreakdown.clear();
+
+  if(lastFrameStart >= 0){
+    std::lock_guard<std::mutex> lock {buffersMutex};
+    for(const auto& buffer : buffers){
+
+      //
+      // Walk back from the newest event; events end in order so once an event ended before the
+      // last frame started all older events did too. Once an event has been overwritten so
+      // have all older events.
+      //
+      uint64_t count = buffer._count.load(std::memory_order_acquire);
+      uint64_t oldest = (count > EVENTS_PER_THREAD) ? count - EVENTS_PER_THREAD : 0;
+      for(uint64_t i = count; i > oldest; --i){
+        Event event;
+        if(!readEvent(buffer, i - 1, event))
+          break;
+        if(event._start + event._duration < lastFrameStart)
+          break;
+        if(event._start >= lastFrameStart && event._start < frameStart)
+          addToBreakdown(event);
+      }
+    }
+    std::sort(frameBreakdown.begin(), frameBreakdown.end(), [](const ScopeTotal& a, const ScopeTotal& b){
+      return a._duration > b._duration;
+    });
+    frameDuration = frameStart - lastFrameStart;
+  }
+
+  lastFrameStart = frameStart;
+}
+
+const std::vector<ScopeTotal>& getFrameBreakdown()
+{
+  return frameBreakdown;
+}
+
+int64_t getFrameDuration()
+{
+  return frameDuration;
+}
+
+static void writeJsonString(std::ofstream& file, const char* str)
+{
+  file << '"';
+  for(; *str != '\0'; ++str){
+    if(*str == '"' || *str == '\\')
+      file << '\\';
+    file << *str;
+  }
+  file << '"';
+}
+
+bool exportChromeTrace(const std::string& filepath)
+{
+  std::ofstream file {filepath, std::ios_base::trunc};
+  if(!file){
+    log::log(log::ERROR, log::msg_prf_fail_export, filepath);
+    return false;
+  }
+
+  //
+  // Timestamps and durations are in microseconds.
+  //
+  file << std::fixed << std::setprecision(3);
+  file << "{\"traceEvents\":[\n";
+
+  bool isFirst {true};
+  std::size_t eventCount {0};
+  std::lock_guard<std::mutex> lock {buffersMutex};
+  for(const auto& buffer : buffers){
+    file << (isFirst ? "" : ",\n");
+    isFirst = false;
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer._id << ",\"args\":{\"name\":";
+    writeJsonString(file, buffer._name.c_str());
+    file << "}}";
+
+    uint64_t count = buffer._count.load(std::memory_order_acquire);
+    uint64_t oldest = (count > EVENTS_PER_THREAD) ? count - EVENTS_PER_THREAD : 0;
+    for(uint64_t i = oldest; i < count; ++i){
+      Event event;
+      if(!readEvent(buffer, i, event))
+        continue;
+      ++eventCount;
+      file << ",\n{\"name\":";
+      writeJsonString(file, event._name);
+      file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer._id
+           << ",\"ts\":" << (event._start / 1000.0)
+           << ",\"dur\":" << (event._duration / 1000.0) << "}";
+    }
+  }
+
+  file << "\n]}\n";
+  if(!file){
+    log::log(log::ERROR, log::msg_prf_fail_export, filepath);
+    return false;
+  }
+
+  log::log(log::INFO, log::msg_prf_exported, filepath + " events=" + std::to_string(eventCount));
+  return true;
+}
+
+} // namespace prof
+} // namespace pxr
@@ -46,6 +46,12 @@ int RC::load(const std::string& filename)
     return -1;
   }
 
+  //
+  // Reset so that properties removed from the file since a previous load revert to defaults.
+  //
+  for(auto& pair : _properties)
+    pair.second._value = unsetValue;
+
   auto lineNoToString = [](int l){return std::string{" ["} + std::to_string(l) + "] ";};
   auto isSpace = [](char c){return std::isspace<char>(c, std::locale::classic());};
 
@@ -3,11 +3,18 @@
 #include <cmath>
 #include <cassert>
 #include <vector>
+#include <cstring>
 #include <algorithm>
+#include <atomic>
+#include <memory>
 #include <SDL2/SDL_mixer.h>
 #include "pxr_sfx.h"
 #include "pxr_log.h"
 #include "pxr_wav.h"
+#include "pxr_name.h"
+#include "pxr_pak.h"
+#include "pxr_worker.h"
+#include "pxr_prof.h"
 
 #include <iostream>
 
@@ -20,16 +27,35 @@ namespace sfx
 // MODULE DATA
 /////////////////////////////////////////////////////////////////////////////////////////////////
 
+//
+// The chunk of a sound is null whilst the sound is loading asynchronously, or if its 
+// asynchronous load failed; such sounds play the error sound.
+//
 struct SoundResource
 {
-  std::string _name = "";
+  name::NameID_t _nameid = name::nullNameID;
   Mix_Chunk* _chunk = nullptr;
   int _referenceCount = 0;
+  bool _isLoading = false;
+};
+
+//
+// An asynchronous sound load in flight. The loading task decodes the wav into pcm in the device
+// format and has sole access to it until it sets _isDone (release), after which the main thread,
+// which polls _isDone (acquire), wraps it in a chunk. The pcm is allocated with SDL_malloc so 
+// the chunk can own it; it is null if the load failed.
+//
+struct AsyncSoundLoad
+{
+  ResourceKey_t _key;
+  uint8_t* _pcm = nullptr;
+  uint32_t _pcmSize = 0;
+  std::atomic<bool> _isDone {false};
 };
 
 struct MusicResource
 {
-  std::string _name = "";
+  name::NameID_t _nameid = name::nullNameID;
   Mix_Music* _music = nullptr;
   int _referenceCount = 0;
 };
@@ -82,6 +108,20 @@ static std::unordered_map<ResourceKey_t, SoundResource> sounds;
 //
 static std::unordered_map<ResourceKey_t, MusicResource> music;
 
+//
+// Maps the interned names of loaded sounds and music to their keys.
+//
+static name::KeyMap<ResourceKey_t> soundKeys;
+static name::KeyMap<ResourceKey_t> musicKeys;
+
+//
+// Asynchronous sound loads in flight and the counts of such loads started and completed since
+// there were last none in flight.
+//
+static std::vector<std::unique_ptr<AsyncSoundLoad>> soundLoads;
+static int asyncLoadsStarted {0};
+static int asyncLoadsCompleted {0};
+
 //
 // Music volume is updated in the update function at the next point in which the update will
 // succeed; volume cannot be set during fade effects.
@@ -166,11 +206,12 @@ static void generateErrorSound(SampleFormat format)
     default: assert(0);
   }
   SoundResource resource {};
-  resource._name = errorSoundName;
+  resource._nameid = name::intern(errorSoundName);
   resource._chunk = chunk;
   resource._referenceCount = 0;
   errorSoundKey = nextResourceKey++;
   sounds.emplace(std::make_pair(errorSoundKey, resource));
+  soundKeys.insert(resource._nameid, errorSoundKey);
 }
 
 static void freeErrorSound()
@@ -181,6 +222,7 @@ static void freeErrorSound()
   delete[] resource._chunk->abuf;
   delete resource._chunk;
   resource._chunk = nullptr;
+  soundKeys.erase(resource._nameid);
   sounds.erase(search);
 }
 
@@ -195,6 +237,8 @@ static bool unloadSound(ResourceKey_t soundKey)
     search->second._referenceCount--;
     if(search->second._referenceCount <= 0){
       Mix_FreeChunk(search->second._chunk);
+      if(soundKeys.find(search->second._nameid) == soundKey)   // failed loads are unmapped.
+        soundKeys.erase(search->second._nameid);
       sounds.erase(search);
       log::log(log::INFO, log::msg_sfx_sound_unloaded, std::to_string(soundKey));
     }
@@ -228,14 +272,15 @@ ResourceKey_t loadSoundWAV(ResourceName_t soundName)
 {
   log::log(log::INFO, log::msg_sfx_loading_sound, soundName);
 
-  for(auto& pair : sounds){
-    if(pair.second._name == soundName){
-      pair.second._referenceCount++;
-      std::string addendum {"reference count="};
-      addendum += std::to_string(pair.second._referenceCount);
-      log::log(log::INFO, log::msg_sfx_sound_already_loaded, addendum);
-      return pair.first;
-    }
+  name::NameID_t nameid = name::intern(soundName);
+  ResourceKey_t loadedKey = soundKeys.find(nameid);
+  if(loadedKey != soundKeys.nullKey){
+    SoundResource& loaded = sounds[loadedKey];
+    loaded._referenceCount++;
+    std::string addendum {"reference count="};
+    addendum += std::to_string(loaded._referenceCount);
+    log::log(log::INFO, log::msg_sfx_sound_already_loaded, addendum);
+    return loadedKey;
   }
 
   SoundResource resource {};
@@ -243,17 +288,22 @@ ResourceKey_t loadSoundWAV(ResourceName_t soundName)
   wavpath += RESOURCE_PATH_SOUNDS;
   wavpath += soundName;
   wavpath += io::Wav::FILE_EXTENSION;
-  resource._chunk = Mix_LoadWAV(wavpath.c_str());
+  const pak::Entry* entry = pak::find(pak::EntryType::SOUND, soundName);
+  if(entry != nullptr)
+    resource._chunk = Mix_LoadWAV_RW(SDL_RWFromConstMem(pak::getData(*entry), entry->_size), 1);
+  else
+    resource._chunk = Mix_LoadWAV(wavpath.c_str());
   if(resource._chunk == nullptr){
     log::log(log::ERROR, log::msg_sfx_fail_load_sound, wavpath + " : " + Mix_GetError());
     log::log(log::INFO, log::msg_sfx_using_error_sound, wavpath);
     return returnErrorSound();
   }
-  resource._name = soundName;
+  resource._nameid = nameid;
   resource._referenceCount = 1;
 
   ResourceKey_t newKey = nextResourceKey++;
   sounds.emplace(std::make_pair(newKey, resource));
+  soundKeys.insert(nameid, newKey);
 
   std::string addendum{};
   addendum += "[name:key]=[";
@@ -266,6 +316,171 @@ ResourceKey_t loadSoundWAV(ResourceName_t soundName)
   return newKey;
 }
 
+//
+// Decodes a wav and converts its samples to the given device format. Returns the pcm, 
+// allocated with SDL_malloc, or null on failure. Uses only the SDL audio functions, which keep
+// no shared state, so is safe to call from the worker threads; SDL_mixer makes no such promise
+// for its loaders.
+//
+static uint8_t* decodeWAV(SDL_RWops* rw, int freq, uint16_t format, int channels, uint32_t& pcmSize)
+{
+  SDL_AudioSpec spec {};
+  uint8_t* wav {nullptr};
+  uint32_t wavSize {0};
+  if(SDL_LoadWAV_RW(rw, 1, &spec, &wav, &wavSize) == nullptr)
+    return nullptr;
+
+  SDL_AudioCVT cvt {};
+  int result = SDL_BuildAudioCVT(&cvt, spec.format, spec.channels, spec.freq, format, channels, freq);
+  if(result < 0){
+    SDL_FreeWAV(wav);
+    return nullptr;
+  }
+  if(result == 0){
+    pcmSize = wavSize;
+    return wav;
+  }
+
+  cvt.len = wavSize;
+  cvt.buf = static_cast<uint8_t*>(SDL_malloc(static_cast<std::size_t>(wavSize) * cvt.len_mult));
+  if(cvt.buf == nullptr){
+    SDL_FreeWAV(wav);
+    return nullptr;
+  }
+  memcpy(cvt.buf, wav, wavSize);
+  SDL_FreeWAV(wav);
+  if(SDL_ConvertAudio(&cvt) != 0){
+    SDL_free(cvt.buf);
+    return nullptr;
+  }
+  pcmSize = cvt.len_cvt;
+  return cvt.buf;
+}
+
+ResourceKey_t loadSoundWAVAsync(ResourceName_t soundName)
+{
+  log::log(log::INFO, log::msg_sfx_loading_sound_async, soundName);
+
+  name::NameID_t nameid = name::intern(soundName);
+  ResourceKey_t loadedKey = soundKeys.find(nameid);
+  if(loadedKey != soundKeys.nullKey){
+    SoundResource& loaded = sounds[loadedKey];
+    loaded._referenceCount++;
+    std::string addendum {"reference count="};
+    addendum += std::to_string(loaded._referenceCount);
+    log::log(log::INFO, log::msg_sfx_sound_already_loaded, addendum);
+    return loadedKey;
+  }
+
+  SoundResource resource {};
+  resource._nameid = nameid;
+  resource._referenceCount = 1;
+  resource._isLoading = true;
+
+  ResourceKey_t newKey = nextResourceKey++;
+  sounds.emplace(std::make_pair(newKey, resource));
+  soundKeys.insert(nameid, newKey);
+
+  std::string wavpath {};
+  wavpath += RESOURCE_PATH_SOUNDS;
+  wavpath += soundName;
+  wavpath += io::Wav::FILE_EXTENSION;
+  const pak::Entry* entry = pak::find(pak::EntryType::SOUND, soundName);
+
+  //
+  // The device format is queried here as the mixer is main thread only.
+  //
+  int freq {sfxconfiguration._samplingFreq_hz};
+  int channels {sfxconfiguration._outputMode};
+  uint16_t format {sfxconfiguration._sampleFormat};
+  Mix_QuerySpec(&freq, &format, &channels);
+
+  soundLoads.push_back(std::make_unique<AsyncSoundLoad>());
+  AsyncSoundLoad* load = soundLoads.back().get();
+  load->_key = newKey;
+  ++asyncLoadsStarted;
+
+  worker::submit([load, entry, wavpath, freq, format, channels](){
+    SDL_RWops* rw = (entry != nullptr) ? SDL_RWFromConstMem(pak::getData(*entry), entry->_size)
+                                       : SDL_RWFromFile(wavpath.c_str(), "rb");
+    if(rw != nullptr)
+      load->_pcm = decodeWAV(rw, freq, format, channels, load->_pcmSize);
+    if(load->_pcm == nullptr)
+      log::log(log::ERROR, log::msg_sfx_fail_load_sound, wavpath + " : " + SDL_GetError());
+    load->_isDone.store(true, std::memory_order_release);
+  });
+
+  return newKey;
+}
+
+//
+// Wraps the pcm of completed asynchronous loads in chunks and moves them into their sounds. The
+// pcm of sounds which were unloaded while loading is freed. Failed loads leave their sounds 
+// playing the error sound and unmap their names so later loads retry.
+//
+static void publishAsyncLoads()
+{
+  auto isPublished = [](std::unique_ptr<AsyncSoundLoad>& load){
+    if(!load->_isDone.load(std::memory_order_acquire))
+      return false;
+
+    ++asyncLoadsCompleted;
+    auto search = sounds.find(load->_key);
+    if(search == sounds.end()){
+      SDL_free(load->_pcm);
+      return true;
+    }
+
+    Mix_Chunk* chunk {nullptr};
+    if(load->_pcm != nullptr){
+      chunk = Mix_QuickLoad_RAW(load->_pcm, load->_pcmSize);
+      if(chunk != nullptr)
+        chunk->allocated = 1;   // the chunk owns the pcm; Mix_FreeChunk frees it.
+      else{
+        std::string addendum {name::getString(search->second._nameid)};
+        log::log(log::ERROR, log::msg_sfx_fail_load_sound, addendum + " : " + Mix_GetError());
+        SDL_free(load->_pcm);
+      }
+    }
+
+    SoundResource& resource = search->second;
+    resource._chunk = chunk;
+    resource._isLoading = false;
+    if(resource._chunk != nullptr)
+      log::log(log::INFO, log::msg_sfx_load_sound_success, name::getString(resource._nameid));
+    else{
+      soundKeys.erase(resource._nameid);
+      log::log(log::INFO, log::msg_sfx_using_error_sound, name::getString(resource._nameid));
+    }
+    return true;
+  };
+
+  soundLoads.erase(std::remove_if(soundLoads.begin(), soundLoads.end(), isPublished), soundLoads.end());
+
+  if(soundLoads.empty()){
+    asyncLoadsStarted = 0;
+    asyncLoadsCompleted = 0;
+  }
+}
+
+bool isSoundLoading(ResourceKey_t soundKey)
+{
+  auto search = sounds.find(soundKey);
+  return search != sounds.end() && search->second._isLoading;
+}
+
+int getAsyncLoadCount()
+{
+  return soundLoads.size();
+}
+
+float getAsyncLoadProgress()
+{
+  if(asyncLoadsStarted == 0)
+    return 1.f;
+  return static_cast<float>(asyncLoadsCompleted) / asyncLoadsStarted;
+}
+
 void queueUnloadSound(ResourceKey_t soundKey)
 {
   assert(soundKey != errorSoundKey);
@@ -279,6 +494,8 @@ static Mix_Chunk* findChunk(ResourceKey_t soundKey)
     log::log(log::WARN, log::msg_sfx_playing_nonexistent_sound, std::to_string(soundKey));
     return nullptr;
   }
+  if(search->second._chunk == nullptr)
+    return sounds[errorSoundKey]._chunk;
   return search->second._chunk;
 }
 
@@ -591,14 +808,15 @@ ResourceKey_t loadMusicWAV(ResourceName_t musicName)
 {
   log::log(log::INFO, log::msg_sfx_loading_music, musicName);
 
-  for(auto& pair : music){
-    if(pair.second._name == musicName){
-      pair.second._referenceCount++;
-      std::string addendum {"reference count="};
-      addendum += std::to_string(pair.second._referenceCount);
-      log::log(log::INFO, log::msg_sfx_music_already_loaded, addendum);
-      return pair.first;
-    }
+  name::NameID_t nameid = name::intern(musicName);
+  ResourceKey_t loadedKey = musicKeys.find(nameid);
+  if(loadedKey != musicKeys.nullKey){
+    MusicResource& loaded = music[loadedKey];
+    loaded._referenceCount++;
+    std::string addendum {"reference count="};
+    addendum += std::to_string(loaded._referenceCount);
+    log::log(log::INFO, log::msg_sfx_music_already_loaded, addendum);
+    return loadedKey;
   }
 
   MusicResource resource {};
@@ -606,17 +824,26 @@ ResourceKey_t loadMusicWAV(ResourceName_t musicName)
   wavpath += RESOURCE_PATH_MUSIC;
   wavpath += musicName;
   wavpath += io::Wav::FILE_EXTENSION;
-  resource._music = Mix_LoadMUS(wavpath.c_str());
+  //
+  // Music is streamed from the archive as it plays so the archive must remain open for as long
+  // as the music is loaded.
+  //
+  const pak::Entry* entry = pak::find(pak::EntryType::MUSIC, musicName);
+  if(entry != nullptr)
+    resource._music = Mix_LoadMUS_RW(SDL_RWFromConstMem(pak::getData(*entry), entry->_size), 1);
+  else
+    resource._music = Mix_LoadMUS(wavpath.c_str());
   if(resource._music == nullptr){
     log::log(log::ERROR, log::msg_sfx_fail_load_music, wavpath + " : " + Mix_GetError());
     log::log(log::WARN, log::msg_sfx_no_error_music);
     return nullResourceKey;
   }
-  resource._name = musicName;
+  resource._nameid = nameid;
   resource._referenceCount = 1;
 
   ResourceKey_t newKey = nextResourceKey++;
   music.emplace(std::make_pair(newKey, resource));
+  musicKeys.insert(nameid, newKey);
 
   std::string addendum{};
   addendum += "[name:key]=[";
@@ -639,6 +866,7 @@ static bool unloadMusic(ResourceKey_t musicKey)
     search->second._referenceCount--;
     if(search->second._referenceCount <= 0){
       Mix_FreeMusic(search->second._music);
+      musicKeys.erase(search->second._nameid);
       music.erase(search);
       log::log(log::INFO, log::msg_sfx_music_unloaded, std::to_string(musicKey));
     }
@@ -787,11 +1015,14 @@ void shutdown()
   for(auto& pair : sounds)
     Mix_FreeChunk(pair.second._chunk);
   sounds.clear();
+  soundKeys.clear();
   Mix_CloseAudio();
 }
 
 void onUpdate(float dt)
 {
+  PXR_PROFILE_SCOPE("sfx::onUpdate");
+  publishAsyncLoads();
   unloadUnusedSounds();
   unloadUnusedMusic();
 
@@ -0,0 +1,114 @@
+#include <string>
+#include <unordered_map>
+#include <cerrno>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include "pxr_watch.h"
+#include "pxr_log.h"
+
+namespace pxr
+{
+namespace watch
+{
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// MODULE DATA
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////
+
+static constexpr uint32_t WATCH_EVENTS {IN_CLOSE_WRITE | IN_MOVED_TO};
+
+static int inotifyfd {-1};
+
+//
+// Maps inotify watch descriptors to the paths of their directories.
+//
+static std::unordered_map<int, std::string> directories;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// MODULE FUNCTIONS
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool initialize()
+{
+  if(inotifyfd != -1)
+    return true;
+
+  inotifyfd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if(inotifyfd == -1){
+    log::log(log::ERROR, log::msg_wch_fail_init, std::to_string(errno));
+    return false;
+  }
+  return true;
+}
+
+void shutdown()
+{
+  if(inotifyfd == -1)
+    return;
+
+  close(inotifyfd);   // also removes all watches.
+  inotifyfd = -1;
+  directories.clear();
+}
+
+bool addDirectory(const char* path)
+{
+  if(inotifyfd == -1)
+    return false;
+
+  int wd = inotify_add_watch(inotifyfd, path, WATCH_EVENTS | IN_ONLYDIR);
+  if(wd == -1){
+    log::log(log::ERROR, log::msg_wch_fail_add, path);
+    return false;
+  }
+
+  std::string directory {path};
+  if(!directory.empty() && directory.back() != '/')
+    directory += '/';
+  directories[wd] = std::move(directory);
+  return true;
+}
+
+void poll(std::vector<std::string>& changedFiles)
+{
+  if(inotifyfd == -1)
+    return;
+
+  //
+  // Events are variable length (the name is appended); the buffer is aligned for the event
+  // struct and large enough for at least one event with the longest name.
+  //
+  alignas(inotify_event) char buffer[4096];
+
+  while(true){
+    ssize_t bytes = read(inotifyfd, buffer, sizeof(buffer));
+    if(bytes <= 0)
+      return;   // EAGAIN; no more events.
+
+    for(char* p = buffer; p < buffer + bytes;){
+      const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+      p += sizeof(inotify_event) + event->len;
+
+      if(event->mask & IN_Q_OVERFLOW){
+        log::log(log::WARN, log::msg_wch_overflow);
+        continue;
+      }
+
+      if(!(event->mask & WATCH_EVENTS) || event->len == 0)
+        continue;
+
+      auto search = directories.find(event->wd);
+      if(search == directories.end())
+        continue;
+
+      changedFiles.push_back(search->second + event->name);
+    }
+  }
+}
+
+} // namespace watch
+} // namespace pxr
@@ -0,0 +1,180 @@
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <string>
+#include "pxr_worker.h"
+#include "pxr_log.h"
+#include "pxr_prof.h"
+
+namespace pxr
+{
+namespace worker
+{
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// MODULE DATA
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////
+
+static std::vector<std::thread> workers;
+
+//
+// All batch state is guarded by the mutex except the next job index which threads use to
+// claim jobs. A new batch is only published once all workers have left the previous batch,
+// thus workers can safely hold copies of the batch state while working on it.
+//
+static std::mutex mutex;
+static std::condition_variable wakeCondition;
+static std::condition_variable doneCondition;
+static const std::function<void(int)>* batchJob {nullptr};
+static int batchJobCount {0};
+static std::atomic<int> batchNextJob {0};
+static int batchWorkersBusy {0};
+static uint64_t batchGeneration {0};
+static bool isShuttingDown {false};
+
+//
+// Background tasks; see submit. Guarded by the mutex.
+//
+static std::deque<std::function<void()>> tasks;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// MODULE FUNCTIONS
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void runBatchJobs(const std::function<void(int)>* job, int jobCount)
+{
+  PXR_PROFILE_SCOPE("worker::batch");
+  int i;
+  while((i = batchNextJob.fetch_add(1, std::memory_order_relaxed)) < jobCount)
+    (*job)(i);
+}
+
+static void workerMain()
+{
+  prof::setThreadName("worker");
+  uint64_t generationDone {0};
+  std::unique_lock<std::mutex> lock {mutex};
+  while(true){
+    wakeCondition.wait(lock, [&generationDone]{
+      return isShuttingDown || batchGeneration != generationDone || !tasks.empty();
+    });
+
+    if(isShuttingDown)
+      return;
+
+    //
+    // Batches take priority over tasks as the main thread is waiting on them.
+    //
+    if(batchGeneration == generationDone){
+      std::function<void()> task = std::move(tasks.front());
+      tasks.pop_front();
+      lock.unlock();
+      {
+        PXR_PROFILE_SCOPE("worker::task");
+        task();
+      }
+      lock.lock();
+      continue;
+    }
+
+    generationDone = batchGeneration;
+    const std::function<void(int)>* job = batchJob;
+    int jobCount = batchJobCount;
+    ++batchWorkersBusy;
+    lock.unlock();
+
+    runBatchJobs(job, jobCount);
+
+    lock.lock();
+    if(--batchWorkersBusy == 0)
+      doneCondition.notify_one();
+  }
+}
+
+void initialize(int workerCount)
+{
+  assert(workers.empty());
+  assert(workerCount >= 0);
+
+  if(workerCount == 0)
+    workerCount = std::max(0, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+
+  isShuttingDown = false;
+  for(int i = 0; i < workerCount; ++i)
+    workers.emplace_back(workerMain);
+
+  log::log(log::INFO, log::msg_wkr_started_workers, std::to_string(workerCount));
+}
+
+void shutdown()
+{
+  {
+    std::lock_guard<std::mutex> lock {mutex};
+    isShuttingDown = true;
+  }
+  wakeCondition.notify_all();
+  for(auto& worker : workers)
+    worker.join();
+  workers.clear();
+  tasks.clear();
+}
+
+int getWorkerCount()
+{
+  return workers.size();
+}
+
+void submit(std::function<void()> task)
+{
+  if(workers.empty()){
+    task();
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock {mutex};
+    tasks.push_back(std::move(task));
+  }
+  wakeCondition.notify_one();
+}
+
+void parallelFor(int jobCount, const std::function<void(int)>& job)
+{
+  if(workers.empty() || jobCount <= 1){
+    for(int i = 0; i < jobCount; ++i)
+      job(i);
+    return;
+  }
+
+  {
+    std::unique_lock<std::mutex> lock {mutex};
+    doneCondition.wait(lock, []{return batchWorkersBusy == 0;});
+    batchJob = &job;
+    batchJobCount = jobCount;
+    batchNextJob.store(0, std::memory_order_relaxed);
+    ++batchGeneration;
+  }
+  wakeCondition.notify_all();
+
+  runBatchJobs(&job, jobCount);
+
+  //
+  // All jobs have been claimed; wait for the workers to finish the ones they claimed. Workers
+  // which wake late will find no jobs left to claim.
+  //
+  std::unique_lock<std::mutex> lock {mutex};
+  doneCondition.wait(lock, []{return batchWorkersBusy == 0;});
+}
+
+} // namespace worker
+} // namespace pxr
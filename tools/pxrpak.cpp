@@ -0,0 +1,299 @@
+//
+// pxrpak - packs the assets/ tree into a single asset archive; see pxr_pak.h.
+//
+// Usage:
+//
+//    pxrpak [app root directory] [output path]
+//
+// The app root directory (the directory containing assets/) defaults to the working directory
+// and the output path, which is w.r.t the app root, defaults to pak::ARCHIVE_PATH where the 
+// engine looks for the archive. Assets which fail to load are logged and skipped; the engine
+// then falls back to the asset files (and thus its usual error handling) for them.
+//
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include "pxr_pak.h"
+#include "pxr_gfx.h"
+#include "pxr_sfx.h"
+#include "pxr_log.h"
+
+using namespace pxr;
+
+namespace fs = std::filesystem;
+
+//
+// The archive is built in memory then written in one go.
+//
+static std::vector<uint8_t> archive;
+static std::vector<pak::Entry> entries;
+
+static void align(std::size_t alignment)
+{
+  archive.resize(((archive.size() + alignment - 1) / alignment) * alignment, 0);
+}
+
+//
+// Appends data to the archive and returns its offset w.r.t the base offset.
+//
+template<typename T>
+static std::size_t append(const T* data, std::size_t count, std::size_t base)
+{
+  std::size_t offset = archive.size();
+  std::size_t bytes = sizeof(T) * count;
+  archive.resize(offset + bytes);
+  if(bytes != 0)
+    memcpy(archive.data() + offset, data, bytes);
+  return offset - base;
+}
+
+//
+// Narrows an offset w.r.t the start of an entry to the 32 bits of the entry records. Returns 
+// false, logging the failure, if the offset does not fit, i.e. the entry is over 4 GiB.
+//
+static bool narrowOffset(std::size_t offset, const std::string& name, uint32_t& narrowed)
+{
+  if(offset > UINT32_MAX){
+    log::log(log::ERROR, log::msg_pak_fail_pack, name + " : entry too large");
+    return false;
+  }
+  narrowed = static_cast<uint32_t>(offset);
+  return true;
+}
+
+//
+// Appends the pixels of an image aligned for use in place by io::Bmp and fills in the image 
+// record; the image data is the full stride * height pixel buffer. Returns false if the pixels
+// are beyond the reach of the record's offset.
+//
+static bool appendImage(const io::Bmp& image, std::size_t base, const std::string& name, 
+                        pak::ImageRecord& record)
+{
+  align(io::Bmp::PIXEL_ALIGNMENT);
+  record._width = image.getWidth();
+  record._height = image.getHeight();
+  record._stride = image.getStride();
+  std::size_t offset = append(image.getPixels(),
+                              static_cast<std::size_t>(image.getStride()) * image.getHeight(),
+                              base);
+  return narrowOffset(offset, name, record._pixelsOffset);
+}
+
+template<typename T>
+static void writeRecord(const T& record, std::size_t offset)
+{
+  memcpy(archive.data() + offset, &record, sizeof(T));
+}
+
+static bool beginEntry(const std::string& name, pak::EntryType type, pak::Entry& entry)
+{
+  if(name.size() >= pak::NAME_MAX_LENGTH){
+    log::log(log::ERROR, log::msg_pak_fail_pack, name + " : name too long");
+    return false;
+  }
+  align(pak::DATA_ALIGNMENT);
+  entry = pak::Entry{};
+  strncpy(entry._name, name.c_str(), pak::NAME_MAX_LENGTH - 1);
+  entry._type = type;
+  entry._offset = archive.size();
+  return true;
+}
+
+static void endEntry(pak::Entry& entry)
+{
+  entry._size = archive.size() - entry._offset;
+  entries.push_back(entry);
+}
+
+//
+// Removes the data of an entry which failed to pack from the archive.
+//
+static void abandonEntry(const pak::Entry& entry)
+{
+  archive.resize(entry._offset);
+}
+
+static void packSpritesheet(const std::string& name)
+{
+  log::log(log::INFO, log::msg_pak_packing, name);
+
+  gfx::Spritesheet sheet {};
+  if(!gfx::readSpritesheet(name.c_str(), sheet)){
+    log::log(log::ERROR, log::msg_pak_fail_pack, name);
+    return;
+  }
+
+  pak::Entry entry {};
+  if(!beginEntry(name, pak::EntryType::SPRITESHEET, entry))
+    return;
+
+  std::size_t base = archive.size();
+  archive.resize(base + sizeof(pak::SpritesheetRecord));
+
+  std::vector<pak::SpriteRecord> sprites {};
+  for(const auto& sprite : sheet._sprites){
+    sprites.push_back(pak::SpriteRecord{
+      sprite._position._x, sprite._position._y,
+      sprite._size._x, sprite._size._y,
+      sprite._origin._x, sprite._origin._y,
+      sprite._rowRunsBase
+    });
+  }
+
+  std::vector<pak::RunRecord> runs {};
+  for(const auto& run : sheet._runs)
+    runs.push_back(pak::RunRecord{run._start, run._length, run._pixelOffset});
+
+  std::vector<int32_t> rowRuns {sheet._rowRuns.begin(), sheet._rowRuns.end()};
+
+  pak::SpritesheetRecord record {};
+  record._spriteCount = sprites.size();
+  record._runCount = runs.size();
+  record._rowRunCount = rowRuns.size();
+  bool isPacked = 
+    narrowOffset(append(sprites.data(), sprites.size(), base), name, record._spritesOffset) &&
+    narrowOffset(append(runs.data(), runs.size(), base), name, record._runsOffset) &&
+    narrowOffset(append(rowRuns.data(), rowRuns.size(), base), name, record._rowRunsOffset) &&
+    appendImage(sheet._image, base, name, record._image);
+  if(!isPacked){
+    abandonEntry(entry);
+    return;
+  }
+  writeRecord(record, base);
+
+  endEntry(entry);
+}
+
+static void packFont(const std::string& name)
+{
+  log::log(log::INFO, log::msg_pak_packing, name);
+
+  gfx::Font font {};
+  if(!gfx::readFont(name.c_str(), font)){
+    log::log(log::ERROR, log::msg_pak_fail_pack, name);
+    return;
+  }
+
+  pak::Entry entry {};
+  if(!beginEntry(name, pak::EntryType::FONT, entry))
+    return;
+
+  std::size_t base = archive.size();
+  archive.resize(base + sizeof(pak::FontRecord));
+
+  std::vector<pak::GlyphRecord> glyphs {};
+  for(const auto& g : font._glyphs){
+    glyphs.push_back(pak::GlyphRecord{
+      g._ascii, g._x, g._y, g._width, g._height, g._xoffset, g._yoffset, g._xadvance
+    });
+  }
+
+  pak::FontRecord record {};
+  record._lineHeight = font._lineHeight;
+  record._baseLine = font._baseLine;
+  record._glyphSpace = font._glyphSpace;
+  record._glyphCount = glyphs.size();
+  bool isPacked = 
+    narrowOffset(append(glyphs.data(), glyphs.size(), base), name, record._glyphsOffset) &&
+    appendImage(font._image, base, name, record._image);
+  if(!isPacked){
+    abandonEntry(entry);
+    return;
+  }
+  writeRecord(record, base);
+
+  endEntry(entry);
+}
+
+static void packWav(const fs::path& path, pak::EntryType type)
+{
+  std::string name = path.stem().string();
+  log::log(log::INFO, log::msg_pak_packing, name);
+
+  std::ifstream file {path, std::ios_base::binary};
+  std::vector<char> bytes {std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+  if(!file && !file.eof()){
+    log::log(log::ERROR, log::msg_pak_fail_pack, name);
+    return;
+  }
+
+  pak::Entry entry {};
+  if(!beginEntry(name, type, entry))
+    return;
+
+  append(bytes.data(), bytes.size(), 0);
+  endEntry(entry);
+}
+
+//
+// Returns the paths of all files in a directory with an extension, sorted so archives are
+// reproducible.
+//
+static std::vector<fs::path> findAssets(const char* directory, const char* extension)
+{
+  std::vector<fs::path> paths {};
+  std::error_code ec {};
+  for(const auto& file : fs::directory_iterator{directory, ec})
+    if(file.is_regular_file() && file.path().extension() == extension)
+      paths.push_back(file.path());
+  std::sort(paths.begin(), paths.end());
+  return paths;
+}
+
+int main(int argc, char* argv[])
+{
+  if(argc > 1){
+    std::error_code ec {};
+    fs::current_path(argv[1], ec);
+    if(ec){
+      log::log(log::ERROR, log::msg_pak_fail_write, std::string{argv[1]} + " : " + ec.message());
+      return EXIT_FAILURE;
+    }
+  }
+  const char* outpath = (argc > 2) ? argv[2] : pak::ARCHIVE_PATH;
+
+  archive.resize(sizeof(pak::Header));
+
+  for(const auto& path : findAssets(gfx::RESOURCE_PATH_SPRITESHEETS, gfx::XML_RESOURCE_EXTENSION_SPRITESHEETS))
+    packSpritesheet(path.stem().string());
+
+  for(const auto& path : findAssets(gfx::RESOURCE_PATH_FONTS, gfx::XML_RESOURCE_EXTENSION_FONTS))
+    packFont(path.stem().string());
+
+  for(const auto& path : findAssets(sfx::RESOURCE_PATH_SOUNDS, ".wav"))
+    packWav(path, pak::EntryType::SOUND);
+
+  for(const auto& path : findAssets(sfx::RESOURCE_PATH_MUSIC, ".wav"))
+    packWav(path, pak::EntryType::MUSIC);
+
+  align(alignof(pak::Entry));
+  pak::Header header {};
+  header._magic = pak::ARCHIVE_MAGIC;
+  header._version = pak::ARCHIVE_VERSION;
+  header._entryCount = entries.size();
+  header._entryTableOffset = append(entries.data(), entries.size(), 0);
+  writeRecord(header, 0);
+
+  std::ofstream file {outpath, std::ios_base::binary | std::ios_base::trunc};
+  file.write(reinterpret_cast<const char*>(archive.data()), archive.size());
+  if(!file){
+    log::log(log::ERROR, log::msg_pak_fail_write, outpath);
+    return EXIT_FAILURE;
+  }
+
+  std::string addendum {outpath};
+  addendum += " entries=";
+  addendum += std::to_string(entries.size());
+  addendum += " size=";
+  addendum += std::to_string(archive.size());
+  addendum += "B";
+  log::log(log::INFO, log::msg_pak_written, addendum);
+
+  return EXIT_SUCCESS;
+}